@@ -0,0 +1,497 @@
+/**
+ * @file Pipeline.cpp
+ * @brief A thread-per-core benchmark of mocked classes flowing through a multi-stage pipeline
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Three stages (produce, decode, encode) each run the given number of worker threads. Producers construct
+ * mocked Messages and move them into a queue; decoders forward calls through their mocked Decoder,
+ * construct a mocked Result and move it on; encoders forward calls through their mocked Encoder and
+ * destroy the Result. Every item exercises vend, mock, move and destroy on several mocked types at once.
+ *
+ * The threads are started once per benchmark and each iteration pushes a batch of items through them.
+ *
+ * Built once per registry configuration: mockvendor_pipeline (default registry) and
+ * mockvendor_pipeline_compact (MOCK_VENDOR_COMPACT_REGISTRY). Reported counters:
+ *  - items_per_second      - Pipeline throughput
+ *  - <stage>_p50_us, <stage>_p99_us, <stage>_p999_us
+ *                          - Service time of an item in each stage (produce, decode, encode): the
+ *                            MockVendor operations and mock calls, excluding the time spent waiting on
+ *                            and handing off to the queues
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // --- Real classes (mocked below) ---
+
+    class Message
+    {
+    public:
+        explicit Message(uint64_t id);
+        Message(Message&& other);
+        ~Message();
+
+        void annotate(int tag);
+        int checksum() const;
+
+        uint64_t id() const { return mId; }
+
+    private:
+        uint64_t            mId;
+    };
+
+    class Result
+    {
+    public:
+        explicit Result(const Message& message);
+        Result(Result&& other);
+        ~Result();
+
+        size_t size() const;
+
+    private:
+        uint64_t            mId;
+    };
+
+    class Decoder
+    {
+    public:
+        Decoder();
+        ~Decoder();
+
+        int decode(const Message& message);
+    };
+
+    class Encoder
+    {
+    public:
+        Encoder();
+        ~Encoder();
+
+        bool encode(const Result& result);
+    };
+
+    // --- Mocks ---
+
+    class MessageMock
+    {
+    public:
+        virtual ~MessageMock() = default;
+
+        MOCK_METHOD(void, annotate, (int tag));
+        MOCK_METHOD(int, checksum, (), (const));
+    };
+
+    class ResultMock
+    {
+    public:
+        virtual ~ResultMock() = default;
+
+        MOCK_METHOD(size_t, size, (), (const));
+    };
+
+    class DecoderMock
+    {
+    public:
+        virtual ~DecoderMock() = default;
+
+        MOCK_METHOD(int, decode, (const Message& message));
+    };
+
+    class EncoderMock
+    {
+    public:
+        virtual ~EncoderMock() = default;
+
+        MOCK_METHOD(bool, encode, (const Result& result));
+    };
+
+    using MessageMockVendor = MockVendor<MessageMock, Message>;
+    using ResultMockVendor = MockVendor<ResultMock, Result>;
+    using DecoderMockVendor = MockVendor<DecoderMock, Decoder>;
+    using EncoderMockVendor = MockVendor<EncoderMock, Encoder>;
+
+    // --- Mocked implementations ---
+
+    Message::Message(uint64_t id)
+        : mId(id)
+    {
+        MessageMockVendor::vend(this);
+    }
+
+    Message::Message(Message&& other)
+        : mId(other.mId)
+    {
+        MessageMockVendor::move(this, &other);
+    }
+
+    Message::~Message()
+    {
+        MessageMockVendor::destroy(this);
+    }
+
+    void Message::annotate(int tag)
+    {
+        return MessageMockVendor::mock(this)->annotate(tag);
+    }
+
+    int Message::checksum() const
+    {
+        return MessageMockVendor::mock(this)->checksum();
+    }
+
+    Result::Result(const Message& message)
+        : mId(message.id())
+    {
+        ResultMockVendor::vend(this);
+    }
+
+    Result::Result(Result&& other)
+        : mId(other.mId)
+    {
+        ResultMockVendor::move(this, &other);
+    }
+
+    Result::~Result()
+    {
+        ResultMockVendor::destroy(this);
+    }
+
+    size_t Result::size() const
+    {
+        return ResultMockVendor::mock(this)->size();
+    }
+
+    Decoder::Decoder()
+    {
+        DecoderMockVendor::vend(this);
+    }
+
+    Decoder::~Decoder()
+    {
+        DecoderMockVendor::destroy(this);
+    }
+
+    int Decoder::decode(const Message& message)
+    {
+        return DecoderMockVendor::mock(this)->decode(message);
+    }
+
+    Encoder::Encoder()
+    {
+        EncoderMockVendor::vend(this);
+    }
+
+    Encoder::~Encoder()
+    {
+        EncoderMockVendor::destroy(this);
+    }
+
+    bool Encoder::encode(const Result& result)
+    {
+        return EncoderMockVendor::mock(this)->encode(result);
+    }
+
+    // --- Pipeline plumbing ---
+
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity)
+            : mCapacity(capacity)
+        {
+        }
+
+        void push(T&& item)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotFull.wait(lock, [this] { return mItems.size() < mCapacity; });
+            mItems.push_back(std::move(item));
+            mNotEmpty.notify_one();
+        }
+
+        std::optional<T> pop()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mNotEmpty.wait(lock, [this] { return !mItems.empty() || mClosed; });
+            if (mItems.empty())
+            {
+                return std::nullopt;
+            }
+
+            std::optional<T> item(std::move(mItems.front()));
+            mItems.pop_front();
+            mNotFull.notify_one();
+            return item;
+        }
+
+        void close()
+        {
+            std::scoped_lock<std::mutex> lock(mMutex);
+            mClosed = true;
+            mNotEmpty.notify_all();
+        }
+
+    private:
+        std::mutex              mMutex;
+        std::condition_variable mNotEmpty;
+        std::condition_variable mNotFull;
+        std::deque<T>           mItems;
+        size_t                  mCapacity;
+        bool                    mClosed{ false };
+    };
+
+    constexpr size_t ITEMS_PER_RUN = 20000;
+    constexpr size_t QUEUE_CAPACITY = 256;
+
+    /**
+     * @brief The service times of the items handled by one worker of each stage, in nanoseconds.
+     */
+    struct StageSamples
+    {
+        std::vector<int64_t>    produce;
+        std::vector<int64_t>    decode;
+        std::vector<int64_t>    encode;
+    };
+
+    int64_t nanosSince(Clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief The three stages and their queues, running until stop().
+     */
+    class Pipeline
+    {
+    public:
+        explicit Pipeline(size_t workers)
+            : mWorkers(workers), mSamples(workers)
+        {
+            for (size_t w = 0; w < workers; ++w)
+            {
+                mProducers.emplace_back([this, w] { _produce(w); });
+                mDecoders.emplace_back([this, w] { _decode(w); });
+                mEncoders.emplace_back([this, w] { _encode(w); });
+            }
+        }
+
+        ~Pipeline()
+        {
+            stop();
+        }
+
+        /**
+         * @brief Push ITEMS_PER_RUN items through the pipeline, and wait until they are all encoded.
+         */
+        void run()
+        {
+            {
+                std::scoped_lock<std::mutex> lock(mMutex);
+                mEncoded = 0;
+                ++mRound;
+            }
+            mRoundStarted.notify_all();
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mRoundFinished.wait(lock, [this] { return mEncoded == ITEMS_PER_RUN; });
+        }
+
+        /**
+         * @brief Stop every stage, in order, once the items in flight are done.
+         */
+        void stop()
+        {
+            {
+                std::scoped_lock<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mRoundStarted.notify_all();
+            _join(mProducers);
+            mDecodeQueue.close();
+            _join(mDecoders);
+            mEncodeQueue.close();
+            _join(mEncoders);
+        }
+
+        /**
+         * @return The samples of every worker (after stop())
+         */
+        const std::vector<StageSamples>& samples() const
+        {
+            return mSamples;
+        }
+
+    private:
+        void _produce(size_t w)
+        {
+            auto& mine = mSamples[w].produce;
+            uint64_t round = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mRoundStarted.wait(lock, [&] { return mStop || mRound != round; });
+                    if (mRound == round)
+                    {
+                        return;
+                    }
+                    round = mRound;
+                }
+
+                for (size_t i = w; i < ITEMS_PER_RUN; i += mWorkers)
+                {
+                    auto start = Clock::now();
+                    Message message(i);
+                    message.annotate(static_cast<int>(w));
+                    mine.push_back(nanosSince(start));
+
+                    mDecodeQueue.push(std::move(message));
+                }
+            }
+        }
+
+        void _decode(size_t w)
+        {
+            auto& mine = mSamples[w].decode;
+            Decoder decoder;
+            while (auto message = mDecodeQueue.pop())
+            {
+                auto start = Clock::now();
+                benchmark::DoNotOptimize(decoder.decode(*message) + message->checksum());
+                Result result(*message);
+                message.reset();
+                mine.push_back(nanosSince(start));
+
+                mEncodeQueue.push(std::move(result));
+            }
+        }
+
+        void _encode(size_t w)
+        {
+            auto& mine = mSamples[w].encode;
+            Encoder encoder;
+            while (auto result = mEncodeQueue.pop())
+            {
+                auto start = Clock::now();
+                benchmark::DoNotOptimize(encoder.encode(*result));
+                benchmark::DoNotOptimize(result->size());
+                result.reset();
+                mine.push_back(nanosSince(start));
+
+                if (mEncoded.fetch_add(1) + 1 == ITEMS_PER_RUN)
+                {
+                    std::scoped_lock<std::mutex> lock(mMutex);
+                    mRoundFinished.notify_one();
+                }
+            }
+        }
+
+        static void _join(std::vector<std::thread>& threads)
+        {
+            for (auto& thread : threads)
+            {
+                if (thread.joinable())
+                {
+                    thread.join();
+                }
+            }
+        }
+
+        const size_t                mWorkers;
+        BoundedQueue<Message>       mDecodeQueue{ QUEUE_CAPACITY };
+        BoundedQueue<Result>        mEncodeQueue{ QUEUE_CAPACITY };
+        std::vector<StageSamples>   mSamples;
+        std::mutex                  mMutex;
+        std::condition_variable     mRoundStarted;
+        std::condition_variable     mRoundFinished;
+        uint64_t                    mRound{ 0 };
+        std::atomic<size_t>         mEncoded{ 0 };
+        bool                        mStop{ false };
+        std::vector<std::thread>    mProducers;
+        std::vector<std::thread>    mDecoders;
+        std::vector<std::thread>    mEncoders;
+    };
+
+    double percentileMicros(std::vector<int64_t>& samples, double percentile)
+    {
+        if (samples.empty())
+        {
+            return 0.0;
+        }
+
+        size_t rank = std::min(samples.size() - 1, static_cast<size_t>(percentile * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank] / 1000.0;
+    }
+
+    void reportStage(benchmark::State& state, const char* stage, std::vector<int64_t>& samples)
+    {
+        std::string prefix(stage);
+        state.counters[prefix + "_p50_us"] = percentileMicros(samples, 0.50);
+        state.counters[prefix + "_p99_us"] = percentileMicros(samples, 0.99);
+        state.counters[prefix + "_p999_us"] = percentileMicros(samples, 0.999);
+    }
+
+    void BM_Pipeline(benchmark::State& state)
+    {
+        const size_t workers = static_cast<size_t>(state.range(0));
+
+        Pipeline pipeline(workers);
+        for (auto _ : state)
+        {
+            pipeline.run();
+        }
+        pipeline.stop();
+
+        StageSamples all;
+        for (const auto& mine : pipeline.samples())
+        {
+            all.produce.insert(all.produce.end(), mine.produce.begin(), mine.produce.end());
+            all.decode.insert(all.decode.end(), mine.decode.begin(), mine.decode.end());
+            all.encode.insert(all.encode.end(), mine.encode.begin(), mine.encode.end());
+        }
+
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * ITEMS_PER_RUN));
+        state.counters["threads"] = static_cast<double>(workers * 3);
+        reportStage(state, "produce", all.produce);
+        reportStage(state, "decode", all.decode);
+        reportStage(state, "encode", all.encode);
+    }
+
+    void workerCounts(benchmark::internal::Benchmark* bench)
+    {
+        // One thread per core across the three stages.
+        size_t maxWorkers = std::max<size_t>(1, std::thread::hardware_concurrency() / 3);
+        for (size_t workers = 1; workers < maxWorkers; workers *= 2)
+        {
+            bench->Arg(static_cast<int64_t>(workers));
+        }
+        bench->Arg(static_cast<int64_t>(maxWorkers));
+    }
+}
+
+BENCHMARK(BM_Pipeline)->Apply(workerCounts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,158 @@
+/**
+ * @file RegistryMemory.cpp
+ * @brief Measures the memory and vend cost of the MockVendor registry per live mocked object
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Built twice: mockvendor_registry_memory (default registry) and mockvendor_registry_memory_compact
+ * (MOCK_VENDOR_COMPACT_REGISTRY). Every heap allocation is counted, and the counters report:
+ *  - bytes_per_object      - Everything allocated per live object, including the mock itself
+ *  - registry_per_object   - The same, less the footprint of a standalone default mock
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace
+{
+    std::atomic<int64_t> gAllocatedBytes{ 0 };
+
+    // Each allocation is prefixed with its size so that frees can be counted too.
+    constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    void* countedAlloc(size_t size)
+    {
+        auto* raw = static_cast<unsigned char*>(std::malloc(size + HEADER_SIZE));
+        if (raw == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        *reinterpret_cast<size_t*>(raw) = size;
+        gAllocatedBytes += static_cast<int64_t>(size);
+        return raw + HEADER_SIZE;
+    }
+
+    void countedFree(void* ptr)
+    {
+        if (ptr != nullptr)
+        {
+            auto* raw = static_cast<unsigned char*>(ptr) - HEADER_SIZE;
+            gAllocatedBytes -= static_cast<int64_t>(*reinterpret_cast<size_t*>(raw));
+            std::free(raw);
+        }
+    }
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { countedFree(ptr); }
+
+namespace
+{
+    class Widget
+    {
+    public:
+        Widget();
+        ~Widget();
+    };
+
+    class WidgetMock
+    {
+    public:
+        virtual ~WidgetMock() = default;
+
+        MOCK_METHOD(int, value, (), (const));
+    };
+
+    using WidgetMockVendor = MockVendor<WidgetMock, Widget>;
+
+    Widget::Widget()
+    {
+        WidgetMockVendor::vend(this);
+    }
+
+    Widget::~Widget()
+    {
+        WidgetMockVendor::destroy(this);
+    }
+
+    /**
+     * @return The bytes a default mock costs on its own (its size plus what gmock allocates for it)
+     */
+    int64_t defaultMockFootprint()
+    {
+        using DefaultMock = testing::NiceMock<WidgetMock>;
+        alignas(DefaultMock) unsigned char storage[sizeof(DefaultMock)];
+
+        int64_t before = gAllocatedBytes;
+        auto* mock = new (storage) DefaultMock();
+        int64_t footprint = gAllocatedBytes - before + static_cast<int64_t>(sizeof(DefaultMock));
+        mock->~DefaultMock();
+        return footprint;
+    }
+
+    void BM_LiveObjects(benchmark::State& state)
+    {
+        const size_t count = static_cast<size_t>(state.range(0));
+        struct alignas(Widget) WidgetStorage { unsigned char bytes[sizeof(Widget)]; };
+        std::vector<WidgetStorage> storage(count);
+        const int64_t mockFootprint = defaultMockFootprint();
+
+        // One untimed round first: gmock's own global tables grow once with the number of live mocks.
+        {
+            WidgetMockVendor vendor;
+            for (auto& slot : storage)
+            {
+                new (slot.bytes) Widget();
+            }
+            for (auto& slot : storage)
+            {
+                reinterpret_cast<Widget*>(slot.bytes)->~Widget();
+            }
+        }
+
+        int64_t bytes = 0;
+        for (auto _ : state)
+        {
+            // The vendor empties the registry when it goes out of scope, so each iteration starts from
+            // an empty registry.
+            WidgetMockVendor vendor;
+
+            int64_t before = gAllocatedBytes;
+            for (auto& slot : storage)
+            {
+                new (slot.bytes) Widget();
+            }
+            bytes = gAllocatedBytes - before;
+
+            state.PauseTiming();
+            for (auto& slot : storage)
+            {
+                reinterpret_cast<Widget*>(slot.bytes)->~Widget();
+            }
+            state.ResumeTiming();
+        }
+
+        state.counters["bytes_per_object"] = static_cast<double>(bytes) / count;
+        state.counters["registry_per_object"] = static_cast<double>(bytes - mockFootprint * static_cast<int64_t>(count)) / count;
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+    }
+}
+
+BENCHMARK(BM_LiveObjects)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,475 @@
+/**
+ * @file TraceReplay.cpp
+ * @brief Replays a recorded MockVendor trace against alternative registry designs
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * Record a trace by running a test suite with MOCK_VENDOR_TRACE=<path>, then run this benchmark with
+ * MOCK_VENDOR_TRACE_REPLAY=<path>. Every registry candidate is driven with the exact recorded
+ * sequence of operations: the events of each recorded thread are replayed in order on a worker thread
+ * of their own, so that the candidates see the recorded contention. With paced=1, each worker also
+ * waits until the recorded timestamp of every event before applying it.
+ *
+ * Built twice: mockvendor_trace_replay (default registry) and mockvendor_trace_replay_compact
+ * (MOCK_VENDOR_COMPACT_REGISTRY). The first candidate is MockVendor itself, driven through its public
+ * API, so it measures the registry of the build. The others are models that vary one axis at a time from
+ * the original design (ordered map, one recursive mutex): the lock type, then the map type, then the lock
+ * granularity.
+ *
+ * The worker threads are created once per benchmark, and each candidate registry is set up and torn down
+ * outside the timed region; only the replay itself is timed.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <benchmark/benchmark.h>
+#include <gtest/gtest-spi.h>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        MockVendorTrace::Op op;
+        uint16_t            type;
+        uintptr_t           ptr;
+        uintptr_t           aux;
+        uint64_t            timestamp;
+    };
+
+    struct Trace
+    {
+        std::vector<std::vector<Event>> threads;    // The events of each recorded thread, in order
+        size_t              eventCount{ 0 };
+        size_t              typeCount{ 0 };
+        std::string         error;
+    };
+
+    // A stand-in for a mock so that the replay still pays for an allocation per default vend.
+    struct Payload
+    {
+        uint64_t value{ 0 };
+    };
+
+    Trace loadTrace(const char* path)
+    {
+        Trace trace;
+        if (path == nullptr)
+        {
+            trace.error = "Set MOCK_VENDOR_TRACE_REPLAY to the path of a recorded trace";
+            return trace;
+        }
+
+        std::ifstream in(path, std::ios::binary);
+        MockVendorTrace::Header header{};
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            !std::equal(std::begin(header.magic), std::end(header.magic), std::begin(MockVendorTrace::MAGIC)) ||
+            header.version != MockVendorTrace::VERSION ||
+            header.recordSize != sizeof(MockVendorTrace::Record))
+        {
+            trace.error = std::string("Not a MockVendor trace: ") + path;
+            return trace;
+        }
+
+        MockVendorTrace::Record rec;
+        while (in.read(reinterpret_cast<char*>(&rec), sizeof(rec)))
+        {
+            auto op = static_cast<MockVendorTrace::Op>(rec.op);
+            trace.typeCount = std::max<size_t>(trace.typeCount, rec.type + 1u);
+            if (op == MockVendorTrace::Op::TypeName)
+            {
+                // The name is only for humans; skip over it.
+                in.seekg(static_cast<std::streamoff>(rec.aux), std::ios::cur);
+                continue;
+            }
+
+            if (rec.thread >= trace.threads.size())
+            {
+                trace.threads.resize(rec.thread + 1u);
+            }
+            trace.threads[rec.thread].push_back(
+                { op, rec.type, static_cast<uintptr_t>(rec.ptr), static_cast<uintptr_t>(rec.aux), rec.timestamp });
+            ++trace.eventCount;
+        }
+
+        return trace;
+    }
+
+    const Trace& theTrace()
+    {
+        static const Trace trace = loadTrace(std::getenv("MOCK_VENDOR_TRACE_REPLAY"));
+        return trace;
+    }
+
+    /**
+     * @brief A candidate registry: one map per mocked type, guarded either by a single global lock
+     * (as MockVendor does) or by a lock per type.
+     * @details Events of one recorded thread may refer to objects vended on another thread that the
+     * replay has not reached yet, so missing entries are tolerated everywhere.
+     */
+    template <typename Map, typename Mutex, bool PerTypeLock>
+    class Registry
+    {
+    public:
+        explicit Registry(size_t typeCount)
+            : mMaps(typeCount), mQueues(typeCount), mMutexes(PerTypeLock ? typeCount : 1)
+        {
+        }
+
+        void apply(const Event& ev)
+        {
+            std::scoped_lock<Mutex> lock(mMutexes[PerTypeLock ? ev.type : 0]);
+            auto& map = mMaps[ev.type];
+            auto& queue = mQueues[ev.type];
+
+            switch (ev.op)
+            {
+            case MockVendorTrace::Op::Vend:
+                if (ev.aux != 0 && !queue.empty())
+                {
+                    map[ev.ptr] = queue.front();
+                    queue.pop_front();
+                }
+                else
+                {
+                    map[ev.ptr] = std::make_shared<Payload>();
+                }
+                break;
+
+            case MockVendorTrace::Op::Mock:
+            {
+                auto it = map.find(ev.ptr);
+                if (it != map.end() && it->second)
+                {
+                    benchmark::DoNotOptimize(++it->second->value);
+                }
+                break;
+            }
+
+            case MockVendorTrace::Op::Move:
+                if (ev.ptr != ev.aux)
+                {
+                    auto it = map.find(ev.aux);
+                    if (it != map.end())
+                    {
+                        auto mock = std::move(it->second);
+                        map.erase(it);
+                        map[ev.ptr] = std::move(mock);
+                    }
+                }
+                break;
+
+            case MockVendorTrace::Op::Destroy:
+                map.erase(ev.ptr);
+                break;
+
+            case MockVendorTrace::Op::QueueMock:
+                queue.push_back(std::make_shared<Payload>());
+                break;
+
+            case MockVendorTrace::Op::Restore:
+            {
+                // The popped mock goes back to the front of the queue; the object keeps the mock it
+                // inherited from the derived class.
+                auto& slot = map[ev.ptr];
+                queue.push_front(slot ? std::move(slot) : std::make_shared<Payload>());
+                slot = std::make_shared<Payload>();
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+    private:
+        std::vector<Map>                                    mMaps;
+        std::vector<std::deque<std::shared_ptr<Payload>>>   mQueues;
+        std::vector<Mutex>                                  mMutexes;
+    };
+
+    template <size_t Tag>
+    class ReplayReal
+    {
+    };
+
+    template <size_t Tag>
+    class ReplayMock
+    {
+    public:
+        virtual ~ReplayMock() = default;
+
+        MOCK_METHOD(int, value, ());
+    };
+
+    /**
+     * @brief The operations of one recorded type, applied to a MockVendor of its own.
+     */
+    class ReplayVendorBase
+    {
+    public:
+        virtual ~ReplayVendorBase() = default;
+
+        virtual void apply(const Event& ev) = 0;
+    };
+
+    template <size_t Tag>
+    class ReplayVendor : public ReplayVendorBase
+    {
+    public:
+        void apply(const Event& ev) override
+        {
+            auto* real = reinterpret_cast<const Real*>(ev.ptr);
+
+            switch (ev.op)
+            {
+            case MockVendorTrace::Op::Vend:
+                // Pops the queue (if there is a queued mock), whatever was recorded.
+                Vendor::vend(real);
+                break;
+
+            case MockVendorTrace::Op::Mock:
+                try
+                {
+                    benchmark::DoNotOptimize(Vendor::mock(real).get());
+                }
+                catch (const MockVendorException&)
+                {
+                    // Vended on a thread that the replay has not reached yet
+                }
+                break;
+
+            case MockVendorTrace::Op::Move:
+                Vendor::move(real, reinterpret_cast<const Real*>(ev.aux));
+                break;
+
+            case MockVendorTrace::Op::Destroy:
+                Vendor::destroy(real);
+                break;
+
+            case MockVendorTrace::Op::QueueMock:
+            case MockVendorTrace::Op::Restore:
+                // A restored mock goes back to the front of the queue, which the public API cannot do; it
+                // is queued at the back instead.
+                mVendor.queueMock(std::make_shared<testing::NiceMock<Mock>>());
+                break;
+
+            default:
+                break;
+            }
+        }
+
+    private:
+        using Real = ReplayReal<Tag>;
+        using Mock = ReplayMock<Tag>;
+        using Vendor = MockVendor<Mock, Real>;
+
+        Vendor mVendor;
+    };
+
+    /**
+     * @brief MockVendor itself, with its registry and its global lock.
+     * @details Each recorded type is replayed on one of a fixed set of mocked types (recorded types beyond
+     * them share). The failures reported for unconsumed and leaked mocks at the end of a replay, and those
+     * of calls on objects that the replay has not vended yet, are discarded.
+     */
+    class VendorRegistry
+    {
+    public:
+        explicit VendorRegistry(size_t typeCount)
+            : mReporter(testing::ScopedFakeTestPartResultReporter::INTERCEPT_ALL_THREADS, &mFailures)
+        {
+            _makeVendors(std::min(typeCount, TYPES), std::make_index_sequence<TYPES>());
+        }
+
+        void apply(const Event& ev)
+        {
+            mVendors[ev.type % mVendors.size()]->apply(ev);
+        }
+
+    private:
+        static constexpr size_t TYPES = 64;
+
+        template <size_t... Tags>
+        void _makeVendors(size_t count, std::index_sequence<Tags...>)
+        {
+            using Factory = std::unique_ptr<ReplayVendorBase> (*)();
+            static const Factory factories[] = { [] () -> std::unique_ptr<ReplayVendorBase>
+                { return std::make_unique<ReplayVendor<Tags>>(); }... };
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                mVendors.push_back(factories[i]());
+            }
+        }
+
+        testing::TestPartResultArray                    mFailures;
+        testing::ScopedFakeTestPartResultReporter       mReporter;
+        std::vector<std::unique_ptr<ReplayVendorBase>>  mVendors;
+    };
+
+    /**
+     * @brief One worker thread per recorded thread, each replaying the events of its thread on request.
+     */
+    template <typename RegistryType>
+    class Replayer
+    {
+    public:
+        Replayer(const Trace& trace, bool paced)
+            : mPaced(paced)
+        {
+            for (const auto& events : trace.threads)
+            {
+                mWorkers.emplace_back([this, &events] { _work(events); });
+            }
+        }
+
+        ~Replayer()
+        {
+            {
+                std::scoped_lock<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mGo.notify_all();
+            for (auto& worker : mWorkers)
+            {
+                worker.join();
+            }
+        }
+
+        /**
+         * @brief Replay the whole trace against the registry, and wait for every worker to finish.
+         */
+        void replay(RegistryType& registry)
+        {
+            {
+                std::scoped_lock<std::mutex> lock(mMutex);
+                mRegistry = &registry;
+                mPending = mWorkers.size();
+                mStart = std::chrono::steady_clock::now();
+                ++mRound;
+            }
+            mGo.notify_all();
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDone.wait(lock, [this] { return mPending == 0; });
+        }
+
+    private:
+        void _work(const std::vector<Event>& events)
+        {
+            uint64_t round = 0;
+            for (;;)
+            {
+                RegistryType* registry;
+                std::chrono::steady_clock::time_point start;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mGo.wait(lock, [&] { return mStop || mRound != round; });
+                    if (mRound == round)
+                    {
+                        return;
+                    }
+                    round = mRound;
+                    registry = mRegistry;
+                    start = mStart;
+                }
+
+                for (const auto& ev : events)
+                {
+                    if (mPaced)
+                    {
+                        std::this_thread::sleep_until(start + std::chrono::nanoseconds(ev.timestamp));
+                    }
+                    registry->apply(ev);
+                }
+
+                std::scoped_lock<std::mutex> lock(mMutex);
+                if (--mPending == 0)
+                {
+                    mDone.notify_one();
+                }
+            }
+        }
+
+        const bool                              mPaced;
+        std::mutex                              mMutex;
+        std::condition_variable                 mGo;
+        std::condition_variable                 mDone;
+        RegistryType*                           mRegistry{ nullptr };
+        std::chrono::steady_clock::time_point   mStart;
+        uint64_t                                mRound{ 0 };
+        size_t                                  mPending{ 0 };
+        bool                                    mStop{ false };
+        std::vector<std::thread>                mWorkers;
+    };
+
+    template <typename RegistryType>
+    void BM_Replay(benchmark::State& state)
+    {
+        const Trace& trace = theTrace();
+        if (!trace.error.empty())
+        {
+            state.SkipWithError(trace.error.c_str());
+            return;
+        }
+
+        Replayer<RegistryType> replayer(trace, state.range(0) != 0);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            auto registry = std::make_unique<RegistryType>(trace.typeCount);
+            state.ResumeTiming();
+
+            replayer.replay(*registry);
+
+            state.PauseTiming();
+            registry.reset();
+            state.ResumeTiming();
+        }
+
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * trace.eventCount));
+        state.counters["threads"] = static_cast<double>(trace.threads.size());
+    }
+
+    using SharedPayload = std::shared_ptr<Payload>;
+    using OrderedMap = std::map<uintptr_t, SharedPayload>;
+    using HashedMap = std::unordered_map<uintptr_t, SharedPayload>;
+
+    // The original design
+    using OrderedGlobalRecursive = Registry<OrderedMap, std::recursive_mutex, false>;
+    // Lock type only
+    using OrderedGlobal = Registry<OrderedMap, std::mutex, false>;
+    // Map type only (against OrderedGlobal)
+    using HashedGlobal = Registry<HashedMap, std::mutex, false>;
+    // Lock granularity only (against OrderedGlobal and HashedGlobal)
+    using OrderedPerType = Registry<OrderedMap, std::mutex, true>;
+    using HashedPerType = Registry<HashedMap, std::mutex, true>;
+
+    void pacing(benchmark::internal::Benchmark* bench)
+    {
+        bench->ArgName("paced")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_Replay, VendorRegistry)->Apply(pacing);
+BENCHMARK_TEMPLATE(BM_Replay, OrderedGlobalRecursive)->Apply(pacing);
+BENCHMARK_TEMPLATE(BM_Replay, OrderedGlobal)->Apply(pacing);
+BENCHMARK_TEMPLATE(BM_Replay, HashedGlobal)->Apply(pacing);
+BENCHMARK_TEMPLATE(BM_Replay, OrderedPerType)->Apply(pacing);
+BENCHMARK_TEMPLATE(BM_Replay, HashedPerType)->Apply(pacing);
+
+BENCHMARK_MAIN();
@@ -26,19 +26,24 @@
 #include <mutex>
 #include <list>
 #include <iomanip>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <new>
+#include <thread>
+#include <condition_variable>
+#include <typeinfo>
+#include <type_traits>
 
-namespace
-{
-    // This mutex is locked for the entirety of every function. This library is focused
-    // on correctness over multi-threading performance (which should not be common in a
-    // testing environment anyway). The technical reason for the coarseness of the lock is
-    // because there is interaction between objects of different types and it is difficult
-    // to make a finer lock. This makes no pretence of concurrency; it effectively
-    // eliminates concurrency in this library.
-    std::recursive_mutex gMockVendorMutex;
-}
-
-class MockVendorException : public std::exception
+#include "MockVendorCore.h"
+
+class MOCK_VENDOR_API MockVendorException : public std::exception
 {
 public: // Methods
     MockVendorException(const std::string message)
@@ -57,6 +62,458 @@ private: // Members
     std::string mMessage;
 };
 
+/**
+ * @brief An opt-in recorder of registry operations for offline benchmarking.
+ * @details When recording, every vend, mock, move, destroy, queueMock and base class restore is appended to a compact
+ * binary trace (type, pointer, thread, timestamp). The trace can then be replayed against alternative
+ * registry designs without running the test suite (see bench/TraceReplay.cpp). Recording is started
+ * either explicitly with start() or by setting the MOCK_VENDOR_TRACE environment variable to the output
+ * path. When not recording, the cost to each operation is a single pointer test.
+ *
+ * File layout: a Header followed by fixed-size Records. The first time a type appears in a trace, a
+ * TypeName record is written whose aux field holds the length of the type name that immediately
+ * follows it. A trace holds at most 65536 distinct types; recording stops if a further type appears.
+ */
+class MOCK_VENDOR_INLINE_API MockVendorTrace
+{
+public: // Definitions
+    enum class Op : uint8_t
+    {
+        TypeName = 0,
+        Vend,               // aux: 1 if the vended mock was popped from the queue
+        Mock,
+        Move,               // ptr: to, aux: from
+        Destroy,
+        QueueMock,          // ptr: the queued mock
+        Restore,            // ptr: the real object, aux: the popped mock returned to the front of the queue
+    };
+
+    struct Header
+    {
+        char                magic[8];
+        uint32_t            version;
+        uint32_t            recordSize;
+    };
+
+    struct Record
+    {
+        uint64_t            timestamp;      // Nanoseconds since the recording started
+        uint64_t            ptr;
+        uint64_t            aux;
+        uint32_t            thread;
+        uint16_t            type;
+        uint8_t             op;
+        uint8_t             reserved;
+    };
+
+    static constexpr char       MAGIC[8] = { 'M', 'V', 'T', 'R', 'A', 'C', 'E', '\0' };
+    static constexpr uint32_t   VERSION = 2;
+
+public: // Methods
+    /**
+     * @brief Start recording to the given file, replacing any recording in progress.
+     * @param[in] path      - The path of the trace file to write
+     * @return true if the file was opened for writing
+     */
+    static bool start(const std::string& path)
+    {
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        stop();
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        std::setvbuf(file, nullptr, _IOFBF, BUFFER_SIZE);
+
+        Header header{};
+        std::copy(std::begin(MAGIC), std::end(MAGIC), header.magic);
+        header.version = VERSION;
+        header.recordSize = sizeof(Record);
+        std::fwrite(&header, sizeof(header), 1, file);
+
+        State& state = _state();
+        state.start = std::chrono::steady_clock::now();
+        ++state.generation;
+        state.nextTypeId = 0;
+        state.file.store(file, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Stop recording and flush the trace file.
+     */
+    static void stop()
+    {
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        if (std::FILE* file = _state().file.exchange(nullptr, std::memory_order_acq_rel))
+        {
+            std::fclose(file);
+        }
+    }
+
+    static bool isRecording()
+    {
+        return _state().file.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /**
+     * @brief Append an operation to the trace.
+     * @param[in] typeSlot  - Per-type storage for the type's trace identifier
+     * @param[in] typeName  - The name of the type (written once per trace)
+     * @details The caller must hold gMockVendorMutex.
+     */
+    static void record(uint32_t& typeSlot, const char* typeName, Op op, const void* ptr, uint64_t aux = 0)
+    {
+        State& state = _state();
+        std::FILE* file = state.file.load(std::memory_order_relaxed);
+        if (file == nullptr)
+        {
+            return;
+        }
+
+        // The slot holds the generation of the trace in the upper half so that types are renamed
+        // in every new trace file.
+        if ((typeSlot >> 16) != (state.generation & 0xFFFF))
+        {
+            if (state.nextTypeId > MAX_TYPE_ID)
+            {
+                // The type field of a Record cannot name another type.
+                std::fprintf(stderr, "MockVendorTrace: more than %u types; recording stopped\n", MAX_TYPE_ID + 1);
+                stop();
+                return;
+            }
+
+            typeSlot = ((state.generation & 0xFFFF) << 16) | state.nextTypeId++;
+            std::string name(typeName);
+            _write(file, static_cast<uint16_t>(typeSlot), Op::TypeName, nullptr, name.size());
+            std::fwrite(name.data(), 1, name.size(), file);
+        }
+
+        _write(file, static_cast<uint16_t>(typeSlot), op, ptr, aux);
+    }
+
+private: // Definitions
+    /**
+     * @brief The process-wide recording state
+     */
+    struct State
+    {
+        std::chrono::steady_clock::time_point   start;
+        uint32_t                                generation{ 0 };
+        uint32_t                                nextTypeId{ 0 };
+        std::atomic<std::FILE*>                 file{ nullptr };    // Written under gMockVendorMutex
+        bool                                    environmentChecked{ false };
+        std::map<std::thread::id, uint32_t>     threads;
+    };
+
+private: // Methods
+    static State& _state()
+    {
+        return mockVendorState<State>();
+    }
+
+    static void _write(std::FILE* file, uint16_t type, Op op, const void* ptr, uint64_t aux)
+    {
+        Record rec{};
+        rec.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _state().start).count());
+        rec.ptr = reinterpret_cast<uintptr_t>(ptr);
+        rec.aux = aux;
+        rec.thread = _threadIndex();
+        rec.type = type;
+        rec.op = static_cast<uint8_t>(op);
+        std::fwrite(&rec, sizeof(rec), 1, file);
+    }
+
+    static uint32_t _threadIndex()
+    {
+        // Numbered in the process-wide state (under gMockVendorMutex), so that a thread has the same index
+        // in every DSO.
+        thread_local uint32_t index = _state().threads.emplace(std::this_thread::get_id(),
+            static_cast<uint32_t>(_state().threads.size())).first->second;
+        return index;
+    }
+
+    static bool _startFromEnvironment()
+    {
+        // Every DSO that includes this header gets here; only the first one starts the recording.
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        State& state = _state();
+        if (state.environmentChecked)
+        {
+            return false;
+        }
+        state.environmentChecked = true;
+
+        const char* path = std::getenv("MOCK_VENDOR_TRACE");
+        if (path != nullptr && *path != '\0' && start(path))
+        {
+            std::atexit(stop);
+            return true;
+        }
+        return false;
+    }
+
+private: // Definitions
+    static constexpr size_t     BUFFER_SIZE = 1 << 20;
+    static constexpr uint32_t   MAX_TYPE_ID = 0xFFFF;
+
+private: // Static Members
+    inline static bool              sFromEnvironment{ _startFromEnvironment() };
+};
+
+/**
+ * @brief Accumulates the time spent inside MockVendor operations.
+ * @details Disabled by default, in which case the cost to each operation is a single relaxed load.
+ * When enabled (normally by MockVendorOverheadListener), the time spent in every public MockVendor
+ * operation, including waiting for the global lock, is added to a process-wide total. The time spent
+ * constructing default mocks is also tracked separately (and is included in the operation total).
+ * Nested operations (e.g. base class links) are only counted once.
+ */
+class MOCK_VENDOR_INLINE_API MockVendorProfiler
+{
+public: // Definitions
+    /**
+     * @brief Times the enclosing scope into one of the profiler's totals.
+     */
+    class Scope
+    {
+    public: // Definitions
+        enum Kind { OPERATION, DEFAULT_MOCK };
+
+    public: // Methods
+        explicit Scope(Kind kind = OPERATION)
+            : mKind(kind)
+        {
+            if (_state().enabled.load(std::memory_order_relaxed))
+            {
+                mCounted = true;
+                if (sDepth[mKind]++ == 0)
+                {
+                    mActive = true;
+                    mStart = std::chrono::steady_clock::now();
+                }
+            }
+        }
+
+        ~Scope()
+        {
+            if (mActive)
+            {
+                auto elapsed = std::chrono::steady_clock::now() - mStart;
+                _total(mKind).fetch_add(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+            }
+
+            if (mCounted)
+            {
+                --sDepth[mKind];
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private: // Members
+        Kind                                        mKind;
+        bool                                        mCounted{ false };
+        bool                                        mActive{ false };
+        std::chrono::steady_clock::time_point       mStart;
+    };
+
+public: // Methods
+    static void enable(bool enabled)
+    {
+        _state().enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled()
+    {
+        return _state().enabled.load(std::memory_order_relaxed);
+    }
+
+    static void reset()
+    {
+        State& state = _state();
+        state.operationNanos.store(0, std::memory_order_relaxed);
+        state.defaultMockNanos.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The total time spent inside MockVendor operations since the last reset
+     */
+    static std::chrono::nanoseconds operationTime()
+    {
+        return std::chrono::nanoseconds(_state().operationNanos.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @return The total time spent constructing default mocks since the last reset
+     */
+    static std::chrono::nanoseconds defaultMockTime()
+    {
+        return std::chrono::nanoseconds(_state().defaultMockNanos.load(std::memory_order_relaxed));
+    }
+
+private: // Definitions
+    /**
+     * @brief The process-wide totals
+     */
+    struct State
+    {
+        std::atomic<bool>                   enabled{ false };
+        std::atomic<uint64_t>               operationNanos{ 0 };
+        std::atomic<uint64_t>               defaultMockNanos{ 0 };
+    };
+
+private: // Methods
+    static State& _state()
+    {
+        return mockVendorState<State>();
+    }
+
+    static std::atomic<uint64_t>& _total(Scope::Kind kind)
+    {
+        return kind == Scope::OPERATION ? _state().operationNanos : _state().defaultMockNanos;
+    }
+
+private: // Static Members
+    // Kept per DSO even with the shared core: an operation nested in one of another DSO is counted twice.
+    inline static thread_local uint32_t     sDepth[2]{};
+};
+
+/**
+ * @brief Frees large amounts of leaked mocks on a background thread.
+ * @details A vendor that finds a very large number of leaked mocks hands them to the reclaimer instead of
+ * freeing them inline, so the end of the leaking test is not stalled. Leaked mocks with unsatisfied
+ * expectations may then report their failures during a later test. The reclaimer is never destroyed;
+ * it is drained and stopped at exit, after which garbage is freed inline. With MOCK_VENDOR_SHARED_CORE
+ * there is one reclaimer in the process, held by the core.
+ */
+class MOCK_VENDOR_INLINE_API MockVendorReclaimer
+{
+public: // Methods
+    /**
+     * @brief Queue an object for destruction on the reclaimer thread.
+     */
+    static void reclaim(std::shared_ptr<void> garbage)
+    {
+        _instance()._push(std::move(garbage));
+    }
+
+    /**
+     * @brief Wait until everything queued so far has been freed.
+     */
+    static void drain()
+    {
+        auto& reclaimer = _instance();
+        std::unique_lock<std::mutex> lock(reclaimer.mMutex);
+        reclaimer.mIdle.wait(lock, [&] { return reclaimer.mGarbage.empty() && !reclaimer.mBusy; });
+    }
+
+    /**
+     * @return Whether the calling thread is the reclaimer thread
+     */
+    static bool isReclaimerThread()
+    {
+        return _instance().mThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+private: // Methods
+    MockVendorReclaimer() = default;
+
+    template <typename State>
+    friend State& mockVendorState();
+#if defined(MOCK_VENDOR_SHARED_CORE)
+    template <typename State>
+    friend State* mockVendorSharedState();
+#endif
+
+    static MockVendorReclaimer& _instance()
+    {
+        return mockVendorState<MockVendorReclaimer>();
+    }
+
+    /**
+     * @brief Free the remaining garbage and stop the thread (at exit, before the statics of the test
+     * framework that were constructed before the thread started are destroyed).
+     */
+    static void _shutdown()
+    {
+        auto& reclaimer = _instance();
+        {
+            std::scoped_lock<std::mutex> lock(reclaimer.mMutex);
+            reclaimer.mStop = true;
+        }
+        reclaimer.mWork.notify_one();
+        reclaimer.mThread.join();
+    }
+
+    void _push(std::shared_ptr<void> garbage)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mStop)
+        {
+            lock.unlock();
+            garbage.reset();
+            return;
+        }
+
+        if (!mThread.joinable())
+        {
+            mThread = std::thread([this] { _run(); });
+            std::atexit(&MockVendorReclaimer::_shutdown);
+        }
+        mGarbage.push_back(std::move(garbage));
+        mWork.notify_one();
+    }
+
+    void _run()
+    {
+        mThreadId = std::this_thread::get_id();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        for (;;)
+        {
+            mWork.wait(lock, [this] { return mStop || !mGarbage.empty(); });
+            if (mGarbage.empty())
+            {
+                // Stopping, and everything has been freed.
+                return;
+            }
+
+            auto garbage = std::move(mGarbage.front());
+            mGarbage.pop_front();
+            mBusy = true;
+
+            lock.unlock();
+            garbage.reset();
+            lock.lock();
+
+            mBusy = false;
+            if (mGarbage.empty())
+            {
+                mIdle.notify_all();
+            }
+        }
+    }
+
+private: // Members
+    std::mutex                          mMutex;
+    std::condition_variable             mWork;
+    std::condition_variable             mIdle;
+    std::list<std::shared_ptr<void>>    mGarbage;
+    std::thread                         mThread;
+    std::atomic<std::thread::id>        mThreadId;
+    bool                                mBusy{ false };
+    bool                                mStop{ false };
+};
+
+class MockVendorScenario;
+
 /**
  * @brief A class that manages the distribution of mocks during a test for a given mock type.
  * @tparam Mock         The type of the mock for the class
@@ -70,12 +527,21 @@ private: // Members
  * test.
  */
 template <typename Mock, typename Real>
-class MockVendor
+class MOCK_VENDOR_INLINE_API MockVendor
 {
 public: // Definitions
     using MockType = Mock;
     using RealType = Real;
 
+    // The number of destroyed objects of the type remembered to diagnose later calls on them (see mock()).
+    // They are kept apart from the live objects, so lookups do not slow down as objects die.
+#if defined(MOCK_VENDOR_NO_LIFETIME_CHECKS)
+    static constexpr size_t MAX_TOMBSTONES = 0;
+#else
+    static constexpr size_t MAX_TOMBSTONES = 1024;
+#endif
+    static_assert((MAX_TOMBSTONES & (MAX_TOMBSTONES - 1)) == 0, "The tombstone ring is indexed with a mask");
+
     template <typename BaseMockType, typename BaseRealType>
     class BaseLink;
 
@@ -83,67 +549,70 @@ public: // Definitions
     template <typename BaseMockType, typename BaseRealType>
     friend class MockVendor<LinkMockType, LinkRealType>::BaseLink;
 
+    friend class MockVendorScenario;
+
 public: // Methods
     MockVendor()
     {
+        MockVendorProfiler::Scope profile;
+
+        // The storage of mocks that outlived the previous vendor is not carried into this test.
+        _freeRecycledBlocks();
+
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
-        sInstance = this;
+        _state().instance = this;
     }
 
     virtual ~MockVendor()
     {
-        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        MockVendorProfiler::Scope profile;
 
-        // Checks
-        if (!mMockList.empty())
+        // Take the registry out in O(1) so that the lock is only held briefly. It is important to clear
+        // the registry so that subsequent tests are not affected and may themselves report any leaks.
+        // This also drops the tombstones.
+        auto leaked = std::make_shared<MockMap>();
         {
-            ADD_FAILURE() << "Failure to consume all queued mocks for " << typeid(MockType).name();
+            std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+            State& state = _state();
+            leaked->swap(state.mockMap);
+            state.instance = nullptr;
         }
 
-        if (!sMockMap.empty())
+        // Checks (nothing else can reach this vendor's queue any more)
+        if (!mMockList.empty())
         {
-            std::ostringstream str;
-            str << "Not all mock instances were destroyed - " << sMockMap.size() << " remaining";
-            if (MAX_LEAKED_REFS > 0)
-            {
-                size_t cnt = 0;
-                for (auto& ref : sMockMap)
-                {
-                    str << std::endl
-                        << "   Real: " << std::left << std::setw(sizeof(void*)*2 + 2) << std::hex << ref.first
-                        << "   Mock: " << std::left << std::setw(sizeof(void*)*2 + 2) << std::hex << ref.second.get();
-                    ++cnt;
-                    if (cnt >= MAX_LEAKED_REFS)
-                    {
-                        if (sMockMap.size() > MAX_LEAKED_REFS)
-                        {
-                            str << std::endl << "    More...";
-                        }
-                        break;
-                    }
-                }
-            }
+            ADD_FAILURE() << _describeUnconsumed();
+        }
 
-            ADD_FAILURE() << str.str();
+        if (leaked->liveCount() > 0)
+        {
+            ADD_FAILURE() << _describeLeaks(*leaked);
+        }
 
-            // It is important to print the message above declaring any mock leaks because the below
-            // clear will wipe out that information.
-            // However, it is important to clear so that subsequent tests are not affected and may
-            // themselves report any leaks.
-            sMockMap.clear();
+        // Free the leaked mocks outside the lock, in the background if there are many of them.
+        if (leaked->liveCount() >= ASYNC_RECLAIM_THRESHOLD)
+        {
+            MockVendorReclaimer::reclaim(std::move(leaked));
         }
+        leaked.reset();
 
-        sInstance = nullptr;
+        // Then free the storage kept for recycling, so that every test starts from the same state.
+        _freeRecycledBlocks();
     }
 
     /**
      * @brief Enqueue a mock for vending in FIFO order.
      * @param[in] mock      - A shared pointer to the mock which to enqueue
+     * @throw MockVendorException if the pointer does not own the mock (e.g. a default mock returned by
+     *        the compact registry)
      */
     void queueMock(const std::shared_ptr<MockType>& mock)
     {
+        MockVendorProfiler::Scope profile;
+        _checkOwned(mock);
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
-        mMockList.push_back(mock);
+        _trace(MockVendorTrace::Op::QueueMock, mock.get());
+        mMockList.push_back({ mock, mQueuedCount++ });
     }
 
     /**
@@ -152,51 +621,73 @@ public: // Methods
      * @details This should be called from the real object's constructor with the 'this' pointer.
      *          If a mock is queued for vending, then it will be delivered. Otherwise, this method
      *          will vend a new mock with no expectations and default return values.
+     *
+     *          The registry storage of destroyed objects is reused (for any address), so object pools
+     *          do not allocate registry nodes. Default mocks are always constructed fresh, but in storage
+     *          recycled from destroyed default mocks (see destroy()).
      */
     static std::shared_ptr<MockType> vend(const RealType* ths)
     {
+        MockVendorProfiler::Scope profile;
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        State& state = _state();
 
-        if (sInstance != nullptr && !sInstance->mMockList.empty())
+        std::shared_ptr<MockType> vended;
+        MockVendor* instance = state.instance;
+        if (instance != nullptr && !instance->mMockList.empty())
         {
             // If we have a mock to vend...
-            sMockMap[ths] = sInstance->mMockList.front();
-            sInstance->mMockList.pop_front();
-            sLastMockWasPopped = true;
+            _trace(MockVendorTrace::Op::Vend, ths, 1);
+            auto& queued = instance->mMockList.front();
+            _checkOwned(queued.mock);
+            vended = state.mockMap.assign(ths, std::move(queued.mock));
+            size_t queueIndex = queued.index;
+            instance->mMockList.pop_front();
+            instance->_recordVend(ths, vended.get(), VendRecord::QUEUED, queueIndex);
+            state.lastPopped = ths;
         }
         else
         {
-            // Otherwise, create a mock to vend.
-            sMockMap[ths] = std::make_shared<testing::NiceMock<MockType>>();
+            // Otherwise, create a mock to vend. A mock that base links share with the base class
+            // registries must be owned, so it cannot come from the compact registry's slab.
+            _trace(MockVendorTrace::Op::Vend, ths, 0);
+            vended = (state.baseLinks != nullptr) ? state.mockMap.assign(ths, _makeDefaultMock()) : state.mockMap.assignDefault(ths);
+            state.lastPopped = nullptr;
+            if (instance != nullptr)
+            {
+                instance->_recordVend(ths, vended.get(), VendRecord::DEFAULT);
+            }
         }
 
-        if (sBaseLinks != nullptr)
+        if (state.baseLinks != nullptr)
         {
             // If we have base classes...
             // We need to un-vend the base classes, but only if they were queued mocks (popped).
-            for (auto linkPtr = sBaseLinks; linkPtr != nullptr; linkPtr = linkPtr->getNext())
+            for (auto linkPtr = state.baseLinks; linkPtr != nullptr; linkPtr = linkPtr->getNext())
             {
-                linkPtr->linkRestoreMockIfPopped(ths, sMockMap[ths]);
+                linkPtr->linkRestoreMockIfPopped(ths, vended);
             }
         }
 
-        return sMockMap[ths];
+        return vended;
     }
 
     /**
      * @brief Destroy the mock associated with the given real object.
      * @param[in] ths       - A pointer to the real object (the 'this')
-     * @details This should be called from the real object's constructor with the 'this' pointer.
+     * @details This should be called from the real object's destructor with the 'this' pointer.
+     *          The mock is released, which verifies and destroys it unless something else still holds it.
+     *          The storage of a destroyed default mock is kept (up to MAX_RECYCLED_MOCKS per type) for
+     *          the next default mock, which is constructed fresh in it. A test's MockVendor frees the
+     *          kept storage when it goes out of scope.
      */
     static void destroy(const RealType* ths)
     {
+        MockVendorProfiler::Scope profile;
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        _trace(MockVendorTrace::Op::Destroy, ths);
 
-        if (sMockMap.find(ths) != sMockMap.end())
-        {
-            // If it is found in the map, delete it.
-            sMockMap.erase(ths);
-        }
+        _state().mockMap.release(ths);
     }
 
     /**
@@ -206,10 +697,13 @@ public: // Methods
      */
     static void move(const RealType* to, const RealType* from)
     {
+        MockVendorProfiler::Scope profile;
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        _trace(MockVendorTrace::Op::Move, to, reinterpret_cast<uintptr_t>(from));
+
         if (from != to)
         {
-            sMockMap[to] = sMockMap[from];
-            sMockMap.erase(from);
+            _state().mockMap.move(to, from);
         }
     }
 
@@ -217,11 +711,23 @@ public: // Methods
      * @brief A method to access the mock from the real layer methods.
      * @param[in] ths       - A pointer to the 'this' object from the real layer methods
      * @return A pointer to the mock for the given 'this'.
+     * @throw MockVendorException if 'this' was destroyed or never vended (unless compiled with
+     *        MOCK_VENDOR_NO_LIFETIME_CHECKS, in which case nullptr is returned).
      */
     static std::shared_ptr<MockType> mock(const RealType* ths)
     {
+        MockVendorProfiler::Scope profile;
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
-        return sMockMap[ths];
+        _trace(MockVendorTrace::Op::Mock, ths);
+
+        auto found = _state().mockMap.get(ths);
+#if !defined(MOCK_VENDOR_NO_LIFETIME_CHECKS)
+        if (found == nullptr)
+        {
+            _lifetimeFailure(ths);
+        }
+#endif
+        return found;
     }
 
     /**
@@ -229,6 +735,7 @@ public: // Methods
      */
     void setStaticMock(const std::shared_ptr<MockType>& staticMock)
     {
+        MockVendorProfiler::Scope profile;
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
         mStaticMock = staticMock;
     }
@@ -239,65 +746,470 @@ public: // Methods
      */
     static std::shared_ptr<MockType> staticMock()
     {
+        MockVendorProfiler::Scope profile;
         std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
-        if (sInstance != nullptr && sInstance->mStaticMock != nullptr)
+        MockVendor* instance = _state().instance;
+        if (instance != nullptr && instance->mStaticMock != nullptr)
         {
-            return sInstance->mStaticMock;
+            return instance->mStaticMock;
         }
         else
         {
             // Return a temporary that will give default values from the mock.
-            return std::make_shared<testing::NiceMock<MockType>>();
+            return _makeDefaultMock();
         }
     }
 
 private: // Definitions
     class BaseLinkBase;
+    class MapRegistry;
+    class CompactRegistry;
 
-    using MockList = std::list<std::shared_ptr<MockType>>;
-    using MockMap = std::map<const RealType*, std::shared_ptr<MockType>>;
-
-    static constexpr size_t MAX_LEAKED_REFS = 15;
-
-private: // Methods
-    static void _addBaseLink(BaseLinkBase* newLink, BaseLinkBase*& next)
-    {
-        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
-        next = sBaseLinks;
-        sBaseLinks = newLink;
-    }
-
-    static bool _wasLastMockPopped()
+    /**
+     * @brief A queued mock along with its position in the order of queueMock() calls
+     */
+    struct QueuedMock
     {
-        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
-        return sLastMockWasPopped;
-    }
+        std::shared_ptr<MockType>   mock;
+        size_t                      index;
+    };
 
-    static void _restoreMock(const RealType* ths, std::shared_ptr<MockType>& poppedMock, const std::shared_ptr<MockType>& inheritedMock)
+    /**
+     * @brief A fixed-size record of one vend, kept in a ring per vendor for queue diagnostics
+     */
+    struct VendRecord
     {
-        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        enum Kind : uint8_t { DEFAULT, QUEUED, RESTORED };
 
-        if (sInstance != nullptr)
-        {
-            sInstance->mMockList.push_front(poppedMock);
-        }
+        uint64_t                    sequence;
+        const void*                 real;
+        const void*                 mock;
+        size_t                      queueIndex;     // Valid for QUEUED and RESTORED
+        size_t                      remaining;      // Mocks left in the queue after this vend
+        Kind                        kind;
+    };
 
-        sMockMap[ths] = inheritedMock;
+    using MockList = std::list<QueuedMock>;
 
-        sLastMockWasPopped = false;
-    }
+    /**
+     * @brief The storage kept from destroyed default mocks (see RecyclingAllocator)
+     */
+    struct RecycledBlocks
+    {
+        std::mutex                  mutex;
+        std::vector<void*>          blocks;
+        size_t                      blockSize{ 0 };
+    };
 
-private: // Static Members
-    inline static MockVendor*       sInstance{ nullptr };
-    inline static MockMap           sMockMap;
-    inline static bool              sLastMockWasPopped{ false };
-    inline static BaseLinkBase*     sBaseLinks{ nullptr };
+    /**
+     * @brief The allocator of default mocks: allocates from, and frees to, the recycled blocks.
+     * @details Used with std::allocate_shared, so a block holds the mock and its control block. The last
+     * reference to a default mock may be dropped on any thread, so the blocks have a lock of their own.
+     */
+    template <typename T>
+    struct RecyclingAllocator
+    {
+        using value_type = T;
 
-private: // Members
-    MockList                        mMockList;
-    std::shared_ptr<MockType>       mStaticMock;
+        RecyclingAllocator() = default;
 
-}; // class MockVendor
+        template <typename U>
+        RecyclingAllocator(const RecyclingAllocator<U>&) {}
+
+        T* allocate(size_t n)
+        {
+            if (_isRecyclable(n))
+            {
+                RecycledBlocks& recycled = _recycledBlocks();
+                std::scoped_lock<std::mutex> lock(recycled.mutex);
+                if (recycled.blockSize == sizeof(T) && !recycled.blocks.empty())
+                {
+                    void* block = recycled.blocks.back();
+                    recycled.blocks.pop_back();
+                    return static_cast<T*>(block);
+                }
+                return static_cast<T*>(::operator new(sizeof(T)));
+            }
+            return std::allocator<T>().allocate(n);
+        }
+
+        void deallocate(T* ptr, size_t n)
+        {
+            // Leaked mocks freed by the reclaimer outlive their vendor's _freeRecycledBlocks(), so their
+            // blocks are not kept.
+            if (_isRecyclable(n) && !MockVendorReclaimer::isReclaimerThread())
+            {
+                RecycledBlocks& recycled = _recycledBlocks();
+                std::scoped_lock<std::mutex> lock(recycled.mutex);
+                if (recycled.blockSize == 0)
+                {
+                    recycled.blockSize = sizeof(T);
+                }
+                if (recycled.blockSize == sizeof(T) && recycled.blocks.size() < MAX_RECYCLED_MOCKS)
+                {
+                    recycled.blocks.push_back(ptr);
+                    return;
+                }
+                ::operator delete(ptr);
+                return;
+            }
+            std::allocator<T>().deallocate(ptr, n);
+        }
+
+        static constexpr bool _isRecyclable(size_t n)
+        {
+            return n == 1 && alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+        }
+
+        template <typename U>
+        bool operator==(const RecyclingAllocator<U>&) const { return true; }
+        template <typename U>
+        bool operator!=(const RecyclingAllocator<U>&) const { return false; }
+    };
+
+#if defined(MOCK_VENDOR_COMPACT_REGISTRY)
+    using MockMap = CompactRegistry;
+#else
+    using MockMap = MapRegistry;
+#endif
+
+    /**
+     * @brief The process-wide state of the type
+     */
+    struct State
+    {
+        MockVendor*                 instance{ nullptr };
+        MockMap                     mockMap;
+        const RealType*             lastPopped{ nullptr };      // The object of the last vend, if it popped a queued mock
+        BaseLinkBase*               baseLinks{ nullptr };
+        uint32_t                    traceTypeId{ 0 };
+    };
+
+    static constexpr size_t MAX_LEAKED_REFS = 15;
+    static constexpr size_t MAX_LEAKED_TYPES = 8;
+    static constexpr size_t ASYNC_RECLAIM_THRESHOLD = 100000;
+    static constexpr size_t MAX_RECYCLED_MOCKS = 4096;
+
+    static constexpr size_t VEND_HISTORY_SIZE = 16;
+
+    /**
+     * @brief The addresses of the most recently destroyed objects, oldest overwritten first.
+     * @details Kept apart from the registry's lookup structure and only searched once a lookup has failed,
+     * so destroyed objects cost nothing on the hot path.
+     */
+    class Tombstones
+    {
+    public: // Methods
+        void add(const RealType* ths)
+        {
+            if constexpr (MAX_TOMBSTONES > 0)
+            {
+                if (mRing.size() < MAX_TOMBSTONES)
+                {
+                    mRing.push_back(ths);
+                }
+                else
+                {
+                    mRing[mNext & (MAX_TOMBSTONES - 1)] = ths;
+                }
+                ++mNext;
+            }
+        }
+
+        bool contains(const RealType* ths) const
+        {
+            return std::find(mRing.begin(), mRing.end(), ths) != mRing.end();
+        }
+
+        void clear()
+        {
+            mRing = std::vector<const RealType*>();
+            mNext = 0;
+        }
+
+        void swap(Tombstones& other)
+        {
+            mRing.swap(other.mRing);
+            std::swap(mNext, other.mNext);
+        }
+
+    private: // Members
+        std::vector<const RealType*>    mRing;
+        size_t                          mNext{ 0 };
+    };
+
+private: // Methods
+    /**
+     * @brief Append mocks staged by a MockVendorScenario (the caller holds the lock).
+     * @details The list nodes are spliced in, so nothing is allocated under the lock.
+     */
+    void _queueStaged(MockList& staged)
+    {
+        for (auto& queued : staged)
+        {
+            _trace(MockVendorTrace::Op::QueueMock, queued.mock.get());
+            queued.index = mQueuedCount++;
+        }
+
+        mMockList.splice(mMockList.end(), staged);
+    }
+
+    void _recordVend(const void* real, const void* mock, typename VendRecord::Kind kind, size_t queueIndex = 0)
+    {
+        VendRecord& rec = mVendHistory[mVendCount % VEND_HISTORY_SIZE];
+        rec.sequence = mVendCount++;
+        rec.real = real;
+        rec.mock = mock;
+        rec.queueIndex = queueIndex;
+        rec.remaining = mMockList.size();
+        rec.kind = kind;
+    }
+
+    /**
+     * @brief Describe leaked mocks: counts per mock type, then a bounded sample.
+     */
+    static std::string _describeLeaks(const MockMap& leaked)
+    {
+        size_t liveCount = leaked.liveCount();
+        std::array<std::pair<const std::type_info*, size_t>, MAX_LEAKED_TYPES> typeCounts{};
+        size_t otherCount = 0;
+        leaked.forEachLive([&](const RealType* /*real*/, const MockType* mock)
+        {
+            const std::type_info& type = _dynamicType(mock);
+            for (auto& typeCount : typeCounts)
+            {
+                if (typeCount.first == nullptr)
+                {
+                    typeCount.first = &type;
+                }
+                if (*typeCount.first == type)
+                {
+                    ++typeCount.second;
+                    return true;
+                }
+            }
+            ++otherCount;
+            return true;
+        });
+
+        std::ostringstream str;
+        str << "Not all mock instances were destroyed - " << liveCount << " remaining";
+        for (auto& typeCount : typeCounts)
+        {
+            if (typeCount.first != nullptr)
+            {
+                str << std::endl << "   " << std::dec << typeCount.second << " x " << typeCount.first->name();
+            }
+        }
+        if (otherCount > 0)
+        {
+            str << std::endl << "   " << std::dec << otherCount << " x (other types)";
+        }
+
+        if (MAX_LEAKED_REFS > 0)
+        {
+            size_t cnt = 0;
+            leaked.forEachLive([&](const RealType* real, const MockType* mock)
+            {
+                str << std::endl
+                    << "   Real: " << std::left << std::setw(sizeof(void*)*2 + 2) << std::hex << real
+                    << "   Mock: " << std::left << std::setw(sizeof(void*)*2 + 2) << std::hex << mock;
+                ++cnt;
+                if (cnt >= MAX_LEAKED_REFS)
+                {
+                    if (liveCount > MAX_LEAKED_REFS)
+                    {
+                        str << std::endl << "    More...";
+                    }
+                    return false;
+                }
+                return true;
+            });
+        }
+
+        return str.str();
+    }
+
+    static const std::type_info& _dynamicType(const MockType* mock)
+    {
+        if constexpr (std::is_polymorphic_v<MockType>)
+        {
+            if (mock != nullptr)
+            {
+                return typeid(*mock);
+            }
+        }
+        return typeid(MockType);
+    }
+
+    std::string _describeUnconsumed() const
+    {
+        std::ostringstream str;
+        str << "Failure to consume all queued mocks for " << typeid(MockType).name()
+            << " - " << mMockList.size() << " of " << mQueuedCount << " remaining";
+
+        size_t cnt = 0;
+        for (auto& queued : mMockList)
+        {
+            if (cnt++ >= MAX_LEAKED_REFS)
+            {
+                str << std::endl << "    More...";
+                break;
+            }
+            str << std::endl << "   Unconsumed: #" << std::dec << queued.index
+                << "   Mock: " << std::hex << queued.mock.get();
+        }
+
+        size_t historyCount = std::min<uint64_t>(mVendCount, VEND_HISTORY_SIZE);
+        str << std::endl << "   Last " << std::dec << historyCount << " of " << mVendCount << " vends (oldest first):";
+        for (uint64_t seq = mVendCount - historyCount; seq < mVendCount; ++seq)
+        {
+            const VendRecord& rec = mVendHistory[seq % VEND_HISTORY_SIZE];
+            str << std::endl << "   Vend #" << std::dec << rec.sequence << ": ";
+            switch (rec.kind)
+            {
+            case VendRecord::QUEUED:    str << "queued #" << rec.queueIndex; break;
+            case VendRecord::RESTORED:  str << "queued #" << rec.queueIndex << " (returned to queue for derived class)"; break;
+            default:                    str << "default"; break;
+            }
+            str << ", " << rec.remaining << " left in queue"
+                << "   Real: " << std::hex << rec.real
+                << "   Mock: " << std::hex << rec.mock;
+        }
+
+        return str.str();
+    }
+
+    [[noreturn]] static void _lifetimeFailure(const RealType* ths)
+    {
+        std::ostringstream str;
+        str << "MockVendor<" << typeid(MockType).name() << ">: call on " << std::hex << ths;
+        if (_state().mockMap.isDestroyed(ths))
+        {
+            str << " after it was destroyed";
+        }
+        else
+        {
+            str << ", which was never vended (or was destroyed before the last " << std::dec << MAX_TOMBSTONES
+                << " destroyed objects of its type)";
+        }
+
+        ADD_FAILURE() << str.str();
+        throw MockVendorException(str.str());
+    }
+
+    static std::shared_ptr<MockType> _makeDefaultMock()
+    {
+        MockVendorProfiler::Scope profile(MockVendorProfiler::Scope::DEFAULT_MOCK);
+        return std::allocate_shared<testing::NiceMock<MockType>>(RecyclingAllocator<testing::NiceMock<MockType>>());
+    }
+
+    static RecycledBlocks& _recycledBlocks()
+    {
+        return mockVendorState<RecycledBlocks>();
+    }
+
+    static void _freeRecycledBlocks()
+    {
+        std::vector<void*> blocks;
+        {
+            RecycledBlocks& recycled = _recycledBlocks();
+            std::scoped_lock<std::mutex> lock(recycled.mutex);
+            blocks.swap(recycled.blocks);
+        }
+
+        for (void* block : blocks)
+        {
+            ::operator delete(block);
+        }
+    }
+
+    static void _checkOwned(const std::shared_ptr<MockType>& mock)
+    {
+        if (mock != nullptr && mock.use_count() == 0)
+        {
+            throw MockVendorException(std::string("MockVendor<") + typeid(MockType).name() +
+                ">: the mock is not owned by the pointer (a default mock of the compact registry cannot be reused)");
+        }
+    }
+
+    static void _trace(MockVendorTrace::Op op, const void* ptr, uint64_t aux = 0)
+    {
+        if (MockVendorTrace::isRecording())
+        {
+            MockVendorTrace::record(_state().traceTypeId, typeid(MockType).name(), op, ptr, aux);
+        }
+    }
+
+    static void _addBaseLink(BaseLinkBase* newLink, BaseLinkBase*& next)
+    {
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        State& state = _state();
+        next = state.baseLinks;
+        state.baseLinks = newLink;
+    }
+
+    /**
+     * @return Whether the most recent vend popped a queued mock for the given object (its base class
+     *         part, when called by a derived class's base link)
+     */
+    static bool _wasLastMockPopped(const RealType* ths)
+    {
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        return _state().lastPopped == ths;
+    }
+
+    static void _restoreMock(const RealType* ths, std::shared_ptr<MockType>& poppedMock, const std::shared_ptr<MockType>& inheritedMock)
+    {
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        State& state = _state();
+
+        if (MockVendor* instance = state.instance)
+        {
+            // The pop being undone is normally this vendor's latest vend. Then the mock goes back with its
+            // queue index and the history entry is amended; otherwise it is queued afresh.
+            VendRecord* rec = nullptr;
+            if (instance->mVendCount > 0)
+            {
+                rec = &instance->mVendHistory[(instance->mVendCount - 1) % VEND_HISTORY_SIZE];
+                if (rec->kind != VendRecord::QUEUED || rec->real != static_cast<const void*>(ths) || rec->mock != poppedMock.get())
+                {
+                    rec = nullptr;
+                }
+            }
+
+            instance->mMockList.push_front({ poppedMock, (rec != nullptr) ? rec->queueIndex : instance->mQueuedCount++ });
+            if (rec != nullptr)
+            {
+                rec->kind = VendRecord::RESTORED;
+                rec->remaining = instance->mMockList.size();
+            }
+        }
+
+        state.mockMap.assign(ths, inheritedMock);
+        _trace(MockVendorTrace::Op::Restore, ths, reinterpret_cast<uintptr_t>(poppedMock.get()));
+
+        state.lastPopped = nullptr;
+    }
+
+    /**
+     * @brief The state of the type (see mockVendorState()).
+     * @details Constructed on first use, so objects may be vended and base links declared during static
+     * initialization.
+     */
+    static State& _state()
+    {
+        return mockVendorState<State>();
+    }
+
+private: // Members
+    MockList                        mMockList;
+    std::shared_ptr<MockType>       mStaticMock;
+    size_t                          mQueuedCount{ 0 };
+    uint64_t                        mVendCount{ 0 };
+    std::array<VendRecord, VEND_HISTORY_SIZE> mVendHistory{};
+
+}; // class MockVendor
 
 
 /**
@@ -344,7 +1256,7 @@ public: // Methods
 
     virtual void linkRestoreMockIfPopped(const RealType* ths, const std::shared_ptr<MockType>& inheritedMock) override
     {
-        if (MockVendor<BaseMockType, BaseRealType>::_wasLastMockPopped())
+        if (MockVendor<BaseMockType, BaseRealType>::_wasLastMockPopped(ths))
         {
             auto poppedMock = MockVendor<BaseMockType, BaseRealType>::mock(ths);
             MockVendor<BaseMockType, BaseRealType>::_restoreMock(ths, poppedMock, inheritedMock);
@@ -352,4 +1264,540 @@ public: // Methods
     }
 };
 
+/**
+ * @brief The default registry: an ordered map from each live real object to its mock.
+ * @details Destroyed objects are erased from the map and remembered in a Tombstones ring. Their map nodes
+ * are kept for the next objects constructed, whatever their address, so an object pool cycling through
+ * its objects does not allocate registry nodes.
+ */
+template <typename MockType, typename RealType>
+class MockVendor<MockType, RealType>::MapRegistry
+{
+public: // Methods
+    /**
+     * @brief Associate a given mock with a real object.
+     */
+    std::shared_ptr<MockType> assign(const RealType* ths, std::shared_ptr<MockType> mock)
+    {
+        auto it = mMap.lower_bound(ths);
+        if (it == mMap.end() || it->first != ths)
+        {
+            it = _insert(it, ths);
+        }
+        it->second = std::move(mock);
+        return it->second;
+    }
+
+    /**
+     * @brief Associate a new default mock with a real object.
+     */
+    std::shared_ptr<MockType> assignDefault(const RealType* ths)
+    {
+        return assign(ths, _makeDefaultMock());
+    }
+
+    /**
+     * @return The mock of a live real object, or nullptr
+     */
+    std::shared_ptr<MockType> get(const RealType* ths) const
+    {
+        auto it = mMap.find(ths);
+        return (it != mMap.end()) ? it->second : nullptr;
+    }
+
+    /**
+     * @brief Release the mock of a real object that is being destroyed.
+     */
+    void release(const RealType* ths)
+    {
+        auto it = mMap.find(ths);
+        if (it != mMap.end())
+        {
+            // Released after the erase, in case the mock's destructor reenters the registry.
+            auto node = mMap.extract(it);
+            auto mock = std::move(node.mapped());
+            mFreeNodes.push_back(std::move(node));
+            mTombstones.add(ths);
+        }
+    }
+
+    /**
+     * @return Whether the object is one of the most recently destroyed (call only when get() failed)
+     */
+    bool isDestroyed(const RealType* ths) const
+    {
+        return mTombstones.contains(ths);
+    }
+
+    void move(const RealType* to, const RealType* from)
+    {
+        auto fromIt = mMap.find(from);
+        if (fromIt != mMap.end())
+        {
+            auto node = mMap.extract(fromIt);
+            auto mock = std::move(node.mapped());
+            mFreeNodes.push_back(std::move(node));
+            assign(to, std::move(mock));
+        }
+    }
+
+    size_t liveCount() const
+    {
+        return mMap.size();
+    }
+
+    /**
+     * @brief Call fn(real, mock) for each live object until it returns false.
+     */
+    template <typename Fn>
+    void forEachLive(Fn&& fn) const
+    {
+        for (auto& ref : mMap)
+        {
+            if (!fn(ref.first, ref.second.get()))
+            {
+                break;
+            }
+        }
+    }
+
+    void clear()
+    {
+        mMap.clear();
+        mFreeNodes = std::vector<typename Map::node_type>();
+        mTombstones.clear();
+    }
+
+    void swap(MapRegistry& other)
+    {
+        mMap.swap(other.mMap);
+        mFreeNodes.swap(other.mFreeNodes);
+        mTombstones.swap(other.mTombstones);
+    }
+
+private: // Definitions
+    using Map = std::map<const RealType*, std::shared_ptr<MockType>>;
+
+private: // Methods
+    /**
+     * @brief Insert an empty entry before the hint, in a recycled node if there is one.
+     */
+    typename Map::iterator _insert(typename Map::iterator hint, const RealType* ths)
+    {
+        if (mFreeNodes.empty())
+        {
+            return mMap.emplace_hint(hint, ths, nullptr);
+        }
+
+        auto node = std::move(mFreeNodes.back());
+        mFreeNodes.pop_back();
+        node.key() = ths;
+        return mMap.insert(hint, std::move(node));
+    }
+
+private: // Members
+    Map                                 mMap;
+    std::vector<typename Map::node_type> mFreeNodes;    // Nodes of destroyed objects, for reuse
+    Tombstones                          mTombstones;
+};
+
+/**
+ * @brief A registry for very large populations of live mocked objects (MOCK_VENDOR_COMPACT_REGISTRY).
+ * @details Each object has a 12 byte entry in an open-addressing hash table (the real object's address
+ * and a 32 bit slot index), instead of a tree node, a shared_ptr and a control block. With the table
+ * between 7/16 and 7/8 full and the unused part of the last slab chunk, the measured overhead is 18 to
+ * 38 bytes per object (see bench/RegistryMemory.cpp).
+ *
+ * Default mocks are constructed in place in a chunked slab and owned by the registry; the shared pointers
+ * returned for them do not own them, so a default mock must not be used after its real object is
+ * destroyed. Queued mocks keep their shared ownership, as do the default mocks of types with base links
+ * (which share them with the base class registries). The slab storage of a destroyed default mock is
+ * reused by the next one.
+ *
+ * Destroyed objects are erased from the table and remembered in a Tombstones ring, as in MapRegistry. The
+ * mode must be selected consistently for the whole program, since it changes the layout of every MockVendor.
+ */
+template <typename MockType, typename RealType>
+class MockVendor<MockType, RealType>::CompactRegistry
+{
+public: // Methods
+    CompactRegistry() = default;
+
+    ~CompactRegistry()
+    {
+        clear();
+    }
+
+    CompactRegistry(const CompactRegistry&) = delete;
+    CompactRegistry& operator=(const CompactRegistry&) = delete;
+
+    /**
+     * @brief Associate a given mock with a real object.
+     * @details The registry shares ownership of the mock, so a non-owning pointer (such as one returned
+     * for a default mock) is rejected rather than left to dangle.
+     */
+    std::shared_ptr<MockType> assign(const RealType* ths, std::shared_ptr<MockType> mock)
+    {
+        _checkOwned(mock);
+
+        uint32_t index;
+        if (!mFreeExternal.empty())
+        {
+            index = mFreeExternal.back();
+            mFreeExternal.pop_back();
+        }
+        else
+        {
+            index = _checkCapacity(mExternal.size());
+            mExternal.emplace_back();
+        }
+        mExternal[index] = std::move(mock);
+
+        Entry& entry = _slot(ths);
+        _releaseMock(entry.slot);
+        entry.slot = EXTERNAL | index;
+        return mExternal[index];
+    }
+
+    /**
+     * @brief Associate a new default mock with a real object.
+     */
+    std::shared_ptr<MockType> assignDefault(const RealType* ths)
+    {
+        Entry& entry = _slot(ths);
+        _releaseMock(entry.slot);
+        entry.slot = _constructDefault();
+        return _mockOf(entry.slot);
+    }
+
+    /**
+     * @return The mock of a live real object, or nullptr
+     */
+    std::shared_ptr<MockType> get(const RealType* ths) const
+    {
+        const Entry* entry = _find(ths);
+        return (entry != nullptr) ? _mockOf(entry->slot) : nullptr;
+    }
+
+    /**
+     * @brief Release the mock of a real object that is being destroyed.
+     */
+    void release(const RealType* ths)
+    {
+        Entry* entry = _find(ths);
+        if (entry != nullptr)
+        {
+            uint32_t slot = entry->slot;
+            _erase(entry);
+            _releaseMock(slot);
+            mTombstones.add(ths);
+        }
+    }
+
+    /**
+     * @return Whether the object is one of the most recently destroyed (call only when get() failed)
+     */
+    bool isDestroyed(const RealType* ths) const
+    {
+        return mTombstones.contains(ths);
+    }
+
+    void move(const RealType* to, const RealType* from)
+    {
+        Entry* fromEntry = _find(from);
+        if (fromEntry != nullptr)
+        {
+            uint32_t slot = fromEntry->slot;
+            _erase(fromEntry);
+
+            Entry& entry = _slot(to);
+            _releaseMock(entry.slot);
+            entry.slot = slot;
+        }
+    }
+
+    size_t liveCount() const
+    {
+        return mSize;
+    }
+
+    /**
+     * @brief Call fn(real, mock) for each live object until it returns false.
+     */
+    template <typename Fn>
+    void forEachLive(Fn&& fn) const
+    {
+        for (auto& entry : mTable)
+        {
+            if (entry.key != 0 &&
+                !fn(reinterpret_cast<const RealType*>(entry.key), _rawMockOf(entry.slot)))
+            {
+                break;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (auto& entry : mTable)
+        {
+            if (entry.key != 0)
+            {
+                _releaseMock(entry.slot);
+            }
+        }
+
+        mTable = std::vector<Entry>();
+        mSize = 0;
+        mTombstones.clear();
+        mShift = 64;
+        mChunks = std::vector<std::unique_ptr<MockStorage[]>>();
+        mDefaultCount = 0;
+        mFreeDefault = std::vector<uint32_t>();
+        mExternal = std::vector<std::shared_ptr<MockType>>();
+        mFreeExternal = std::vector<uint32_t>();
+    }
+
+    void swap(CompactRegistry& other)
+    {
+        mTable.swap(other.mTable);
+        std::swap(mSize, other.mSize);
+        mTombstones.swap(other.mTombstones);
+        std::swap(mShift, other.mShift);
+        mChunks.swap(other.mChunks);
+        std::swap(mDefaultCount, other.mDefaultCount);
+        mFreeDefault.swap(other.mFreeDefault);
+        mExternal.swap(other.mExternal);
+        mFreeExternal.swap(other.mFreeExternal);
+    }
+
+private: // Definitions
+    using DefaultMock = testing::NiceMock<MockType>;
+
+#pragma pack(push, 4)
+    struct Entry
+    {
+        uint64_t        key;        // The address of the real object (0 when empty)
+        uint32_t        slot;       // Flags and the index of the mock
+    };
+#pragma pack(pop)
+    static_assert(sizeof(Entry) == 12, "Compact registry entries must stay at 12 bytes");
+
+    struct alignas(DefaultMock) MockStorage
+    {
+        unsigned char   bytes[sizeof(DefaultMock)];
+    };
+
+    static constexpr uint32_t   EXTERNAL = 1u << 31;            // Index into mExternal (else into the slab)
+    static constexpr uint32_t   INDEX_MASK = EXTERNAL - 1;
+    static constexpr uint32_t   NO_MOCK = INDEX_MASK;
+
+    static constexpr size_t     CHUNK_BITS = 12;
+    static constexpr size_t     CHUNK_MASK = (size_t(1) << CHUNK_BITS) - 1;
+    static constexpr size_t     MIN_CAPACITY = 64;
+
+private: // Methods
+    static uint32_t _checkCapacity(size_t index)
+    {
+        if (index >= NO_MOCK)
+        {
+            throw MockVendorException("Compact MockVendor registry capacity exceeded");
+        }
+        return static_cast<uint32_t>(index);
+    }
+
+    size_t _home(uint64_t key) const
+    {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> mShift);
+    }
+
+    const Entry* _find(const RealType* ths) const
+    {
+        if (mTable.empty())
+        {
+            return nullptr;
+        }
+
+        uint64_t key = reinterpret_cast<uintptr_t>(ths);
+        size_t mask = mTable.size() - 1;
+        for (size_t i = _home(key); ; i = (i + 1) & mask)
+        {
+            if (mTable[i].key == key)
+            {
+                return &mTable[i];
+            }
+            if (mTable[i].key == 0)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    Entry* _find(const RealType* ths)
+    {
+        return const_cast<Entry*>(static_cast<const CompactRegistry*>(this)->_find(ths));
+    }
+
+    /**
+     * @brief Find or insert the slot for a real object.
+     */
+    Entry& _slot(const RealType* ths)
+    {
+        if (Entry* entry = _find(ths))
+        {
+            return *entry;
+        }
+
+        if ((mSize + 1) * 8 > mTable.size() * 7)
+        {
+            _grow();
+        }
+
+        uint64_t key = reinterpret_cast<uintptr_t>(ths);
+        size_t mask = mTable.size() - 1;
+        size_t i = _home(key);
+        while (mTable[i].key != 0)
+        {
+            i = (i + 1) & mask;
+        }
+
+        mTable[i].key = key;
+        mTable[i].slot = NO_MOCK;
+        ++mSize;
+        return mTable[i];
+    }
+
+    void _grow()
+    {
+        size_t capacity = std::max(MIN_CAPACITY, mTable.size() * 2);
+        std::vector<Entry> old(capacity);
+        old.swap(mTable);
+
+        mShift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+        {
+            --mShift;
+        }
+
+        size_t mask = capacity - 1;
+        for (auto& entry : old)
+        {
+            if (entry.key != 0)
+            {
+                size_t i = _home(entry.key);
+                while (mTable[i].key != 0)
+                {
+                    i = (i + 1) & mask;
+                }
+                mTable[i] = entry;
+            }
+        }
+    }
+
+    /**
+     * @brief Remove an entry, shifting back later members of its probe sequence (no hash tombstones).
+     */
+    void _erase(Entry* entry)
+    {
+        size_t mask = mTable.size() - 1;
+        size_t hole = static_cast<size_t>(entry - mTable.data());
+        for (size_t i = (hole + 1) & mask; mTable[i].key != 0; i = (i + 1) & mask)
+        {
+            size_t home = _home(mTable[i].key);
+            bool reachable = (hole <= i) ? (home <= hole || home > i) : (home <= hole && home > i);
+            if (reachable)
+            {
+                mTable[hole] = mTable[i];
+                hole = i;
+            }
+        }
+
+        mTable[hole] = Entry{};
+        --mSize;
+    }
+
+    DefaultMock* _defaultMock(uint32_t index) const
+    {
+        return std::launder(reinterpret_cast<DefaultMock*>(mChunks[index >> CHUNK_BITS][index & CHUNK_MASK].bytes));
+    }
+
+    uint32_t _constructDefault()
+    {
+        MockVendorProfiler::Scope profile(MockVendorProfiler::Scope::DEFAULT_MOCK);
+
+        uint32_t index;
+        if (!mFreeDefault.empty())
+        {
+            index = mFreeDefault.back();
+            mFreeDefault.pop_back();
+        }
+        else
+        {
+            index = _checkCapacity(mDefaultCount);
+            if ((index >> CHUNK_BITS) >= mChunks.size())
+            {
+                mChunks.emplace_back(new MockStorage[CHUNK_MASK + 1]);
+            }
+            ++mDefaultCount;
+        }
+
+        new (mChunks[index >> CHUNK_BITS][index & CHUNK_MASK].bytes) DefaultMock();
+        return index;
+    }
+
+    void _releaseMock(uint32_t slot)
+    {
+        uint32_t index = slot & INDEX_MASK;
+        if (index == NO_MOCK)
+        {
+            return;
+        }
+
+        if ((slot & EXTERNAL) != 0)
+        {
+            mExternal[index].reset();
+            mFreeExternal.push_back(index);
+        }
+        else
+        {
+            _defaultMock(index)->~DefaultMock();
+            mFreeDefault.push_back(index);
+        }
+    }
+
+    MockType* _rawMockOf(uint32_t slot) const
+    {
+        uint32_t index = slot & INDEX_MASK;
+        if (index == NO_MOCK)
+        {
+            return nullptr;
+        }
+        return (slot & EXTERNAL) != 0 ? mExternal[index].get() : _defaultMock(index);
+    }
+
+    std::shared_ptr<MockType> _mockOf(uint32_t slot) const
+    {
+        if ((slot & EXTERNAL) != 0)
+        {
+            return mExternal[slot & INDEX_MASK];
+        }
+
+        // Non-owning: default mocks belong to the registry.
+        return std::shared_ptr<MockType>(std::shared_ptr<MockType>(), _rawMockOf(slot));
+    }
+
+private: // Members
+    std::vector<Entry>                          mTable;
+    size_t                                      mSize{ 0 };
+    Tombstones                                  mTombstones;
+    unsigned                                    mShift{ 64 };
+
+    std::vector<std::unique_ptr<MockStorage[]>> mChunks;
+    uint32_t                                    mDefaultCount{ 0 };
+    std::vector<uint32_t>                       mFreeDefault;
+
+    std::vector<std::shared_ptr<MockType>>      mExternal;
+    std::vector<uint32_t>                       mFreeExternal;
+};
+
 #endif // __MOCK_VENDOR_H__
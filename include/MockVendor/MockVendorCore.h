@@ -0,0 +1,128 @@
+/**
+ * @file MockVendorCore.h
+ * @brief Process-wide state and symbol visibility shared by every MockVendor
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#ifndef __MOCK_VENDOR_CORE_H__
+#define __MOCK_VENDOR_CORE_H__
+
+#include <mutex>
+
+#if defined(MOCK_VENDOR_SHARED_CORE)
+#include <cstring>
+#include <typeinfo>
+#endif
+
+// Symbol visibility
+//
+// Every mocked type keeps its registry in state owned by MockVendor<Mock, Real>. When mocked classes are
+// spread across several shared libraries, that state (and the global mutex below) must exist once per
+// process, even when the libraries are built with -fvisibility=hidden.
+//
+// By default the state is held in inline (vague-linkage) variables, and the classes and globals of this
+// library are given default visibility so that the ELF dynamic linker merges the copies from every DSO.
+// An instantiation is never more visible than its template arguments, so mock classes that live in
+// hidden-by-default libraries must also be declared with MOCK_VENDOR_API. This relies on the merging of
+// vague-linkage symbols (STB_GNU_UNIQUE or symbol interposition), so it does not hold with
+// -fno-gnu-unique and RTLD_LOCAL, nor for Windows DLLs; and every access goes through the GOT.
+//
+// Defining MOCK_VENDOR_SHARED_CORE (done automatically when linking the mockvendor_core target) instead
+// keeps all of the process-wide state in the small mockvendor_core shared library: the mutex, and a
+// table of state objects keyed by type name (the registry of each mocked type, the trace recorder and the
+// profiler totals). Each DSO looks its state up once and caches the pointer in a hidden variable. The
+// classes of this library are then hidden (MOCK_VENDOR_INLINE_API), so calls and data accesses within a
+// DSO are direct, and mock classes need no MOCK_VENDOR_API.
+#ifndef MOCK_VENDOR_API
+#   if defined(_WIN32)
+#       define MOCK_VENDOR_API
+#   else
+#       define MOCK_VENDOR_API __attribute__((visibility("default")))
+#   endif
+#endif
+
+#ifndef MOCK_VENDOR_CORE_API
+#   if defined(_WIN32) && defined(MOCK_VENDOR_CORE_BUILD)
+#       define MOCK_VENDOR_CORE_API __declspec(dllexport)
+#   elif defined(_WIN32) && defined(MOCK_VENDOR_SHARED_CORE)
+#       define MOCK_VENDOR_CORE_API __declspec(dllimport)
+#   else
+#       define MOCK_VENDOR_CORE_API MOCK_VENDOR_API
+#   endif
+#endif
+
+#ifndef MOCK_VENDOR_INLINE_API
+#   if defined(MOCK_VENDOR_SHARED_CORE) && !defined(_WIN32)
+#       define MOCK_VENDOR_INLINE_API __attribute__((visibility("hidden")))
+#   else
+#       define MOCK_VENDOR_INLINE_API MOCK_VENDOR_API
+#   endif
+#endif
+
+// This mutex is locked for the entirety of every function. This library is focused
+// on correctness over multi-threading performance (which should not be common in a
+// testing environment anyway). The technical reason for the coarseness of the lock is
+// because there is interaction between objects of different types and it is difficult
+// to make a finer lock. This makes no pretence of concurrency; it effectively
+// eliminates concurrency in this library.
+#if defined(MOCK_VENDOR_SHARED_CORE)
+extern MOCK_VENDOR_CORE_API std::recursive_mutex gMockVendorMutex;
+#else
+MOCK_VENDOR_API inline std::recursive_mutex gMockVendorMutex;
+#endif
+
+#if defined(MOCK_VENDOR_SHARED_CORE)
+/**
+ * @brief Find (or create) a process-wide state object in the core.
+ * @param[in] key       - The unique name of the state
+ * @param[in] create    - Allocates the state; called once per key, under the core's lock
+ * @return The state, which is never destroyed
+ */
+MOCK_VENDOR_CORE_API void* mockVendorCoreState(const char* key, void* (*create)());
+
+/**
+ * @brief The process-wide instance of a state type, keyed by the name of the type.
+ * @details mockVendorState() caches the result, so the core is only consulted once per DSO. Types in an
+ * anonymous namespace are private to their translation unit, and their names are not unique in the
+ * process, so they get a state of their own instead.
+ */
+template <typename State>
+State* mockVendorSharedState()
+{
+    auto create = [] () -> void* { return new State(); };
+
+    const char* key = typeid(State).name();
+    if (std::strstr(key, "_GLOBAL__N") != nullptr || std::strstr(key, "anonymous namespace") != nullptr)
+    {
+        return static_cast<State*>(create());
+    }
+    return static_cast<State*>(mockVendorCoreState(key, create));
+}
+#endif
+
+/**
+ * @brief The process-wide instance of a state type, created on first use and never destroyed (mocked
+ * objects and vendors may still use it during static destruction).
+ * @details With MOCK_VENDOR_SHARED_CORE it is held by the core, and each DSO caches the pointer.
+ */
+template <typename State>
+MOCK_VENDOR_INLINE_API State& mockVendorState()
+{
+#if defined(MOCK_VENDOR_SHARED_CORE)
+    static State* const state = mockVendorSharedState<State>();
+#else
+    static State* const state = new State();
+#endif
+    return *state;
+}
+
+#endif // __MOCK_VENDOR_CORE_H__
@@ -0,0 +1,91 @@
+/**
+ * @file MockVendorListener.h
+ * @brief A gtest listener that reports the MockVendor overhead of each test
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#ifndef __MOCK_VENDOR_LISTENER_H__
+#define __MOCK_VENDOR_LISTENER_H__
+
+#include "MockVendor.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+/**
+ * @brief Records the share of each test's time spent inside MockVendor as test properties.
+ * @details Install from main() before RUN_ALL_TESTS():
+ *
+ *      testing::UnitTest::GetInstance()->listeners().Append(new MockVendorOverheadListener);
+ *
+ * Every test then gets the following properties in the XML/JSON reports:
+ *  - mock_vendor_us            - Time spent in MockVendor operations (microseconds)
+ *  - mock_vendor_default_us    - Of which constructing default mocks (microseconds)
+ *  - mock_vendor_wall_us       - The wall time of the test as measured by this listener (microseconds)
+ *  - mock_vendor_pct           - mock_vendor_us as a percentage of mock_vendor_wall_us
+ *
+ * Time spent on other threads during the test is included, so the share may exceed 100% when
+ * mocked objects are used concurrently.
+ */
+class MOCK_VENDOR_INLINE_API MockVendorOverheadListener : public testing::EmptyTestEventListener
+{
+public: // Methods
+    MockVendorOverheadListener()
+    {
+        MockVendorProfiler::enable(true);
+    }
+
+    virtual ~MockVendorOverheadListener()
+    {
+        MockVendorProfiler::enable(false);
+    }
+
+    virtual void OnTestStart(const testing::TestInfo& /*testInfo*/) override
+    {
+        MockVendorProfiler::reset();
+        mStart = std::chrono::steady_clock::now();
+    }
+
+    virtual void OnTestEnd(const testing::TestInfo& /*testInfo*/) override
+    {
+        auto wall = std::chrono::steady_clock::now() - mStart;
+        double wallUs = _toMicroseconds(wall);
+        double vendorUs = _toMicroseconds(MockVendorProfiler::operationTime());
+
+        testing::Test::RecordProperty("mock_vendor_us", _format(vendorUs));
+        testing::Test::RecordProperty("mock_vendor_default_us", _format(_toMicroseconds(MockVendorProfiler::defaultMockTime())));
+        testing::Test::RecordProperty("mock_vendor_wall_us", _format(wallUs));
+        testing::Test::RecordProperty("mock_vendor_pct", _format(wallUs > 0.0 ? 100.0 * vendorUs / wallUs : 0.0));
+    }
+
+private: // Methods
+    template <typename Duration>
+    static double _toMicroseconds(Duration duration)
+    {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    static std::string _format(double value)
+    {
+        std::ostringstream str;
+        str << std::fixed << std::setprecision(1) << value;
+        return str.str();
+    }
+
+private: // Members
+    std::chrono::steady_clock::time_point   mStart;
+};
+
+#endif // __MOCK_VENDOR_LISTENER_H__
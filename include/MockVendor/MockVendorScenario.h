@@ -0,0 +1,130 @@
+/**
+ * @file MockVendorScenario.h
+ * @brief Stage queued mocks for many mocked types and commit them atomically
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#ifndef __MOCK_VENDOR_SCENARIO_H__
+#define __MOCK_VENDOR_SCENARIO_H__
+
+#include "MockVendor.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Builds the queued mocks of a test scenario across any number of MockVendors.
+ * @details Mocks are staged without taking the global lock, then commit() appends every staged mock to
+ * its vendor's queue under a single acquisition of the lock. Threads constructing mocked objects
+ * concurrently therefore see either none or all of the scenario. Staged mocks that are never committed
+ * are discarded with the scenario. The vendors must outlive the commit.
+ *
+ *      MyClassMockVendor myClassVendor;
+ *      MyOtherClassMockVendor myOtherClassVendor;
+ *
+ *      MockVendorScenario scenario;
+ *      scenario.queueMock(myClassVendor, myClassMock1)
+ *              .queueMock(myOtherClassVendor, myOtherClassMock)
+ *              .queueMock(myClassVendor, myClassMock2);
+ *      scenario.commit();
+ */
+class MOCK_VENDOR_INLINE_API MockVendorScenario
+{
+public: // Methods
+    MockVendorScenario() = default;
+    ~MockVendorScenario() = default;
+
+    MockVendorScenario(const MockVendorScenario&) = delete;
+    MockVendorScenario& operator=(const MockVendorScenario&) = delete;
+
+    /**
+     * @brief Stage a mock to be queued on a vendor when the scenario is committed.
+     * @param[in] vendor    - The vendor that will vend the mock
+     * @param[in] mock      - A shared pointer to the mock which to enqueue
+     * @return This scenario, for chaining
+     * @throw MockVendorException if the pointer does not own the mock (see MockVendor::queueMock())
+     */
+    template <typename Vendor>
+    MockVendorScenario& queueMock(Vendor& vendor, const std::shared_ptr<typename Vendor::MockType>& mock)
+    {
+        Vendor::_checkOwned(mock);
+        _staged(vendor).mocks.push_back({ mock, 0 });
+        return *this;
+    }
+
+    /**
+     * @brief Queue every staged mock on its vendor, atomically with respect to other MockVendor operations.
+     * @details The scenario is empty afterwards and may be reused.
+     */
+    void commit()
+    {
+        std::vector<std::unique_ptr<StagedBase>> staged;
+        staged.swap(mStaged);
+
+        MockVendorProfiler::Scope profile;
+        std::scoped_lock<std::recursive_mutex> lock(gMockVendorMutex);
+        for (auto& stagedMocks : staged)
+        {
+            stagedMocks->commit();
+        }
+    }
+
+private: // Definitions
+    struct StagedBase
+    {
+        virtual ~StagedBase() = default;
+        virtual void commit() = 0;
+
+        const void*     vendor{ nullptr };
+    };
+
+    template <typename Vendor>
+    struct Staged : public StagedBase
+    {
+        virtual void commit() override
+        {
+            MockVendorScenario::_commit(*static_cast<Vendor*>(const_cast<void*>(this->vendor)), mocks);
+        }
+
+        typename Vendor::MockList   mocks;
+    };
+
+private: // Methods
+    template <typename Vendor>
+    Staged<Vendor>& _staged(Vendor& vendor)
+    {
+        // A scenario spans a handful of types, so a linear search is cheapest.
+        for (auto& staged : mStaged)
+        {
+            if (staged->vendor == &vendor)
+            {
+                return static_cast<Staged<Vendor>&>(*staged);
+            }
+        }
+
+        auto staged = std::make_unique<Staged<Vendor>>();
+        staged->vendor = &vendor;
+        mStaged.push_back(std::move(staged));
+        return static_cast<Staged<Vendor>&>(*mStaged.back());
+    }
+
+    template <typename Vendor>
+    static void _commit(Vendor& vendor, typename Vendor::MockList& mocks)
+    {
+        vendor._queueStaged(mocks);
+    }
+
+private: // Members
+    std::vector<std::unique_ptr<StagedBase>>    mStaged;
+};
+
+#endif // __MOCK_VENDOR_SCENARIO_H__
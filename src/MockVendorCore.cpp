@@ -0,0 +1,34 @@
+/**
+ * @file MockVendorCore.cpp
+ * @brief The single definition of the process-wide MockVendor state (MOCK_VENDOR_SHARED_CORE)
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "MockVendor/MockVendorCore.h"
+
+#include <string>
+#include <unordered_map>
+
+std::recursive_mutex gMockVendorMutex;
+
+void* mockVendorCoreState(const char* key, void* (*create)())
+{
+    // Never destroyed: mocked objects may still be destroyed during static destruction.
+    static std::mutex* mutex = new std::mutex();
+    static auto* states = new std::unordered_map<std::string, void*>();
+
+    std::scoped_lock<std::mutex> lock(*mutex);
+    void*& state = (*states)[key];
+    if (state == nullptr)
+    {
+        state = create();
+    }
+    return state;
+}
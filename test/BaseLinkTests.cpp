@@ -0,0 +1,197 @@
+/**
+ * @file BaseLinkTests.cpp
+ * @brief Tests of mocks shared between derived and base class registries
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <gtest/gtest.h>
+
+using testing::Return;
+
+namespace
+{
+    class Shape
+    {
+    public:
+        Shape();
+        virtual ~Shape();
+
+        int sides();
+    };
+
+    class Circle : public Shape
+    {
+    public:
+        Circle();
+        ~Circle() override;
+
+        int radius();
+    };
+
+    class Label
+    {
+    public:
+        Label();
+        ~Label();
+    };
+
+    class ShapeMock
+    {
+    public:
+        virtual ~ShapeMock() = default;
+
+        MOCK_METHOD(int, sides, ());
+    };
+
+    class CircleMock : public ShapeMock
+    {
+    public:
+        MOCK_METHOD(int, radius, ());
+    };
+
+    class LabelMock
+    {
+    public:
+        virtual ~LabelMock() = default;
+
+        MOCK_METHOD(int, length, ());
+    };
+
+    using ShapeMockVendor = MockVendor<ShapeMock, Shape>;
+    using CircleMockVendor = MockVendor<CircleMock, Circle>;
+    using LabelMockVendor = MockVendor<LabelMock, Label>;
+
+    CircleMockVendor::BaseLink<ShapeMock, Shape> gCircleToShape;
+
+    Shape::Shape()
+    {
+        ShapeMockVendor::vend(this);
+    }
+
+    Shape::~Shape()
+    {
+        ShapeMockVendor::destroy(this);
+    }
+
+    int Shape::sides()
+    {
+        return ShapeMockVendor::mock(this)->sides();
+    }
+
+    Circle::Circle()
+    {
+        CircleMockVendor::vend(this);
+    }
+
+    Circle::~Circle()
+    {
+        CircleMockVendor::destroy(this);
+    }
+
+    int Circle::radius()
+    {
+        return CircleMockVendor::mock(this)->radius();
+    }
+
+    Label::Label()
+    {
+        LabelMockVendor::vend(this);
+    }
+
+    Label::~Label()
+    {
+        LabelMockVendor::destroy(this);
+    }
+}
+
+TEST(BaseLinkTest, DerivedDefaultMockIsSharedWithTheBase)
+{
+    ShapeMockVendor shapeVendor;
+    auto queuedShape = std::make_shared<testing::NiceMock<ShapeMock>>();
+    ON_CALL(*queuedShape, sides()).WillByDefault(Return(4));
+    shapeVendor.queueMock(queuedShape);
+
+    {
+        // The queued shape mock is popped by the Shape constructor, then returned to the queue.
+        Circle circle;
+        auto circleMock = CircleMockVendor::mock(&circle);
+        EXPECT_EQ(circleMock, ShapeMockVendor::mock(&circle));
+        EXPECT_GT(circleMock.use_count(), 1);
+        EXPECT_EQ(0, circle.sides());
+        EXPECT_EQ(0, circle.radius());
+    }
+
+    Shape square;
+    EXPECT_EQ(4, square.sides());
+}
+
+TEST(BaseLinkTest, RestoredMockKeepsItsQueuePosition)
+{
+    ShapeMockVendor shapeVendor;
+    auto firstShape = std::make_shared<testing::NiceMock<ShapeMock>>();
+    auto secondShape = std::make_shared<testing::NiceMock<ShapeMock>>();
+    shapeVendor.queueMock(firstShape);
+    shapeVendor.queueMock(secondShape);
+
+    std::weak_ptr<CircleMock> circleMock;
+    {
+        Circle circle;
+        circleMock = CircleMockVendor::mock(&circle);
+    }
+    EXPECT_TRUE(circleMock.expired());
+
+    Shape first;
+    Shape second;
+    EXPECT_EQ(firstShape, ShapeMockVendor::mock(&first));
+    EXPECT_EQ(secondShape, ShapeMockVendor::mock(&second));
+}
+
+TEST(BaseLinkTest, ConsumedBaseMockIsNotRestoredByALaterDerivedObject)
+{
+    ShapeMockVendor shapeVendor;
+    auto queuedShape = std::make_shared<testing::NiceMock<ShapeMock>>();
+    shapeVendor.queueMock(queuedShape);
+
+    {
+        Shape shape;
+        EXPECT_EQ(queuedShape, ShapeMockVendor::mock(&shape));
+    }
+
+    // The circle's base class part gets a default mock, so nothing is returned to the queue.
+    {
+        Circle circle;
+    }
+
+    auto nextShape = std::make_shared<testing::NiceMock<ShapeMock>>();
+    shapeVendor.queueMock(nextShape);
+    Shape next;
+    EXPECT_EQ(nextShape, ShapeMockVendor::mock(&next));
+}
+
+TEST(BaseLinkTest, NonOwningMockIsRejected)
+{
+    LabelMockVendor vendor;
+    Label label;
+    auto mock = LabelMockVendor::mock(&label);
+
+    if (mock.use_count() == 0)
+    {
+        // A default mock of the compact registry
+        EXPECT_THROW(vendor.queueMock(mock), MockVendorException);
+    }
+    else
+    {
+        EXPECT_NO_THROW(vendor.queueMock(mock));
+        Label next;
+        EXPECT_EQ(mock, LabelMockVendor::mock(&next));
+    }
+}
@@ -0,0 +1,178 @@
+/**
+ * @file LifetimeTests.cpp
+ * @brief Tests of the diagnosis of calls on destroyed or never-vended objects
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+#include <new>
+#include <vector>
+
+namespace
+{
+    class Probe
+    {
+    public:
+        Probe();
+        ~Probe();
+
+        int read();
+    };
+
+    class ProbeMock
+    {
+    public:
+        virtual ~ProbeMock() = default;
+
+        MOCK_METHOD(int, read, ());
+    };
+
+    using ProbeMockVendor = MockVendor<ProbeMock, Probe>;
+
+    Probe::Probe()
+    {
+        ProbeMockVendor::vend(this);
+    }
+
+    Probe::~Probe()
+    {
+        ProbeMockVendor::destroy(this);
+    }
+
+    int Probe::read()
+    {
+        return ProbeMockVendor::mock(this)->read();
+    }
+
+    struct ProbeStorage
+    {
+        alignas(Probe) unsigned char bytes[sizeof(Probe)];
+
+        Probe* construct() { return new (bytes) Probe(); }
+        Probe* get() { return std::launder(reinterpret_cast<Probe*>(bytes)); }
+    };
+}
+
+#if defined(MOCK_VENDOR_NO_LIFETIME_CHECKS)
+
+TEST(LifetimeTest, DestroyedObjectHasNoMock)
+{
+    ProbeMockVendor vendor;
+    ProbeStorage storage;
+    Probe* probe = storage.construct();
+    EXPECT_EQ(0, probe->read());
+    probe->~Probe();
+
+    EXPECT_EQ(nullptr, ProbeMockVendor::mock(storage.get()));
+}
+
+#else
+
+namespace
+{
+    // Each test declares a vendor, so that it starts with an empty registry.
+    constexpr size_t TOMBSTONES = ProbeMockVendor::MAX_TOMBSTONES;
+
+    /**
+     * @brief Call through a probe that is expected to be dead.
+     * @return The diagnosis, or an empty string if the call succeeded
+     */
+    std::string diagnose(Probe* probe)
+    {
+        testing::TestPartResultArray failures;
+        testing::ScopedFakeTestPartResultReporter reporter(
+            testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, &failures);
+        try
+        {
+            probe->read();
+        }
+        catch (const MockVendorException& e)
+        {
+            EXPECT_EQ(1, failures.size());
+            return e.what();
+        }
+        return "";
+    }
+
+    void churn(std::vector<ProbeStorage>& storage)
+    {
+        for (auto& slot : storage)
+        {
+            slot.construct()->~Probe();
+        }
+    }
+}
+
+TEST(LifetimeTest, CallAfterDestroy)
+{
+    ProbeMockVendor vendor;
+    ProbeStorage storage;
+    storage.construct()->~Probe();
+
+    EXPECT_THAT(diagnose(storage.get()), testing::HasSubstr("after it was destroyed"));
+}
+
+TEST(LifetimeTest, CallWithoutVend)
+{
+    ProbeMockVendor vendor;
+    ProbeStorage storage;
+
+    EXPECT_THAT(diagnose(storage.get()), testing::HasSubstr("which was never vended"));
+}
+
+TEST(LifetimeTest, RecentDestroysAreDiagnosedAfterManyDeaths)
+{
+    ProbeMockVendor vendor;
+    std::vector<ProbeStorage> storage(TOMBSTONES * 4);
+    churn(storage);
+
+    // The oldest tombstones were evicted; the most recent ones were kept.
+    EXPECT_THAT(diagnose(storage.front().get()), testing::HasSubstr("which was never vended"));
+    EXPECT_THAT(diagnose(storage[storage.size() - TOMBSTONES].get()), testing::HasSubstr("after it was destroyed"));
+    EXPECT_THAT(diagnose(storage.back().get()), testing::HasSubstr("after it was destroyed"));
+}
+
+TEST(LifetimeTest, ReconstructedAddressKeepsItsNewestTombstone)
+{
+    ProbeMockVendor vendor;
+    ProbeStorage reused;
+    reused.construct()->~Probe();
+    reused.construct()->~Probe();
+
+    // The ring position of the first death is evicted, but it no longer names the tombstone.
+    std::vector<ProbeStorage> storage(TOMBSTONES - 1);
+    churn(storage);
+    EXPECT_THAT(diagnose(reused.get()), testing::HasSubstr("after it was destroyed"));
+
+    // One more death evicts the second.
+    ProbeStorage last;
+    last.construct()->~Probe();
+    EXPECT_THAT(diagnose(reused.get()), testing::HasSubstr("which was never vended"));
+    EXPECT_THAT(diagnose(last.get()), testing::HasSubstr("after it was destroyed"));
+}
+
+TEST(LifetimeTest, LiveObjectsSurviveEviction)
+{
+    ProbeMockVendor vendor;
+    ProbeStorage survivor;
+    Probe* probe = survivor.construct();
+
+    std::vector<ProbeStorage> storage(TOMBSTONES * 2);
+    churn(storage);
+
+    EXPECT_EQ(0, probe->read());
+    probe->~Probe();
+}
+
+#endif
@@ -0,0 +1,162 @@
+/**
+ * @file ListenerTests.cpp
+ * @brief Tests of the test properties recorded by MockVendorOverheadListener
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendorListener.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+    class Sensor
+    {
+    public:
+        Sensor();
+        ~Sensor();
+
+        int read();
+    };
+
+    class SensorMock
+    {
+    public:
+        virtual ~SensorMock() = default;
+
+        MOCK_METHOD(int, read, ());
+    };
+
+    using SensorMockVendor = MockVendor<SensorMock, Sensor>;
+
+    Sensor::Sensor()
+    {
+        SensorMockVendor::vend(this);
+    }
+
+    Sensor::~Sensor()
+    {
+        SensorMockVendor::destroy(this);
+    }
+
+    int Sensor::read()
+    {
+        return SensorMockVendor::mock(this)->read();
+    }
+
+    /**
+     * @brief The listener is installed for the tests of this suite only.
+     */
+    class OverheadListenerTest : public testing::Test
+    {
+    protected:
+        static void SetUpTestSuite()
+        {
+            sListener = new MockVendorOverheadListener;
+            testing::UnitTest::GetInstance()->listeners().Append(sListener);
+        }
+
+        static void TearDownTestSuite()
+        {
+            delete testing::UnitTest::GetInstance()->listeners().Release(sListener);
+            sListener = nullptr;
+        }
+
+        /**
+         * @return The properties recorded for an earlier test of this suite, or nothing if it did not run
+         */
+        static std::map<std::string, std::string> propertiesOf(const std::string& name)
+        {
+            std::map<std::string, std::string> properties;
+            const testing::TestSuite* suite = testing::UnitTest::GetInstance()->current_test_suite();
+            for (int i = 0; i < suite->total_test_count(); ++i)
+            {
+                const testing::TestInfo* info = suite->GetTestInfo(i);
+                if (info->name() == name)
+                {
+                    const testing::TestResult* result = info->result();
+                    for (int p = 0; p < result->test_property_count(); ++p)
+                    {
+                        const testing::TestProperty& property = result->GetTestProperty(p);
+                        properties[property.key()] = property.value();
+                    }
+                }
+            }
+            return properties;
+        }
+
+    private:
+        inline static MockVendorOverheadListener* sListener{ nullptr };
+    };
+}
+
+TEST_F(OverheadListenerTest, MeasuresTheOperationsOfTheTest)
+{
+    EXPECT_TRUE(MockVendorProfiler::isEnabled());
+
+    std::vector<Sensor> sensors(100);
+    for (auto& sensor : sensors)
+    {
+        EXPECT_EQ(0, sensor.read());
+    }
+
+    EXPECT_GT(MockVendorProfiler::operationTime().count(), 0);
+    EXPECT_GT(MockVendorProfiler::defaultMockTime().count(), 0);
+    EXPECT_LE(MockVendorProfiler::defaultMockTime(), MockVendorProfiler::operationTime());
+}
+
+TEST_F(OverheadListenerTest, RecordsThePropertiesOfEachTest)
+{
+    // The totals were reset when this test started, and the profiler is still enabled.
+    EXPECT_TRUE(MockVendorProfiler::isEnabled());
+    EXPECT_EQ(0, MockVendorProfiler::operationTime().count());
+    EXPECT_EQ(0, MockVendorProfiler::defaultMockTime().count());
+
+    auto properties = propertiesOf("MeasuresTheOperationsOfTheTest");
+    if (properties.empty())
+    {
+        GTEST_SKIP() << "MeasuresTheOperationsOfTheTest did not run before this test";
+    }
+
+    ASSERT_EQ(4u, properties.size());
+    ASSERT_EQ(1u, properties.count("mock_vendor_us"));
+    ASSERT_EQ(1u, properties.count("mock_vendor_default_us"));
+    ASSERT_EQ(1u, properties.count("mock_vendor_wall_us"));
+    ASSERT_EQ(1u, properties.count("mock_vendor_pct"));
+
+    double vendorUs = std::strtod(properties["mock_vendor_us"].c_str(), nullptr);
+    double defaultUs = std::strtod(properties["mock_vendor_default_us"].c_str(), nullptr);
+    double wallUs = std::strtod(properties["mock_vendor_wall_us"].c_str(), nullptr);
+    double pct = std::strtod(properties["mock_vendor_pct"].c_str(), nullptr);
+
+    // 100 objects vended, mocked and destroyed
+    EXPECT_GT(vendorUs, 0.0);
+    EXPECT_LE(defaultUs, vendorUs);
+    EXPECT_LE(vendorUs, wallUs);
+    EXPECT_GT(pct, 0.0);
+    EXPECT_LE(pct, 100.0);
+}
+
+TEST(OverheadListenerRemovedTest, ProfilerIsDisabledWithTheListener)
+{
+    EXPECT_FALSE(MockVendorProfiler::isEnabled());
+
+    auto before = MockVendorProfiler::operationTime();
+    {
+        Sensor sensor;
+        EXPECT_EQ(0, sensor.read());
+    }
+    EXPECT_EQ(before, MockVendorProfiler::operationTime());
+}
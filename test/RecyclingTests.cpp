@@ -0,0 +1,163 @@
+/**
+ * @file RecyclingTests.cpp
+ * @brief Tests of registry slot reuse and default mock storage recycling
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+#include <new>
+#include <vector>
+
+using testing::Return;
+
+namespace
+{
+    class Gauge
+    {
+    public:
+        Gauge();
+        ~Gauge();
+
+        int get();
+    };
+
+    class GaugeMock
+    {
+    public:
+        GaugeMock()
+        {
+            ON_CALL(*this, get()).WillByDefault(Return(42));
+        }
+        virtual ~GaugeMock() = default;
+
+        MOCK_METHOD(int, get, ());
+    };
+
+    using GaugeMockVendor = MockVendor<GaugeMock, Gauge>;
+
+    Gauge::Gauge()
+    {
+        GaugeMockVendor::vend(this);
+    }
+
+    Gauge::~Gauge()
+    {
+        GaugeMockVendor::destroy(this);
+    }
+
+    int Gauge::get()
+    {
+        return GaugeMockVendor::mock(this)->get();
+    }
+
+    // Storage for constructing objects repeatedly at the same address, as an object pool would.
+    struct GaugeStorage
+    {
+        alignas(Gauge) unsigned char bytes[sizeof(Gauge)];
+
+        Gauge* construct() { return new (bytes) Gauge(); }
+    };
+}
+
+TEST(RecyclingTest, DefaultsFromTheMockConstructorApplyAfterReuse)
+{
+    GaugeStorage storage{};
+
+    Gauge* gauge = storage.construct();
+    EXPECT_EQ(42, gauge->get());
+    ON_CALL(*GaugeMockVendor::mock(gauge), get()).WillByDefault(Return(7));
+    EXPECT_EQ(7, gauge->get());
+    gauge->~Gauge();
+
+    // Same address: the slot is reused, but the mock must be as fresh as any other default mock.
+    gauge = storage.construct();
+    EXPECT_EQ(42, gauge->get());
+    gauge->~Gauge();
+}
+
+TEST(RecyclingTest, DefaultMockStorageIsReused)
+{
+    const GaugeMock* first;
+    {
+        Gauge gauge;
+        first = GaugeMockVendor::mock(&gauge).get();
+    }
+
+    Gauge gauge;
+    EXPECT_EQ(first, GaugeMockVendor::mock(&gauge).get());
+    EXPECT_EQ(42, gauge.get());
+}
+
+TEST(RecyclingTest, DestroyVerifiesTheDefaultMock)
+{
+    EXPECT_NONFATAL_FAILURE(
+    {
+        GaugeStorage storage{};
+        Gauge* gauge = storage.construct();
+        EXPECT_CALL(*GaugeMockVendor::mock(gauge), get()).Times(1);
+        gauge->~Gauge();
+    }, "Actual: never called");
+
+    // The expectation does not leak into the next object at the same address.
+    GaugeStorage storage{};
+    Gauge* gauge = storage.construct();
+    EXPECT_EQ(42, gauge->get());
+    gauge->~Gauge();
+}
+
+TEST(RecyclingTest, QueuedMockAfterReuse)
+{
+    GaugeMockVendor vendor;
+    GaugeStorage storage{};
+
+    Gauge* gauge = storage.construct();
+    gauge->~Gauge();
+
+    auto queued = std::make_shared<testing::NiceMock<GaugeMock>>();
+    ON_CALL(*queued, get()).WillByDefault(Return(5));
+    vendor.queueMock(queued);
+
+    gauge = storage.construct();
+    EXPECT_EQ(queued, GaugeMockVendor::mock(gauge));
+    EXPECT_EQ(5, gauge->get());
+    gauge->~Gauge();
+
+    gauge = storage.construct();
+    EXPECT_EQ(42, gauge->get());
+    gauge->~Gauge();
+}
+
+TEST(RecyclingTest, PoolLargerThanTheTombstoneRingCyclesThroughFreshMocks)
+{
+    // More objects than are remembered as destroyed, so reuse cannot rely on the tombstones.
+    std::vector<GaugeStorage> pool(2048 + 1);
+
+    for (int cycle = 0; cycle < 2; ++cycle)
+    {
+        std::vector<Gauge*> gauges;
+        for (auto& storage : pool)
+        {
+            gauges.push_back(storage.construct());
+        }
+        for (Gauge* gauge : gauges)
+        {
+            EXPECT_EQ(42, gauge->get());
+            ON_CALL(*GaugeMockVendor::mock(gauge), get()).WillByDefault(Return(cycle));
+        }
+        for (Gauge* gauge : gauges)
+        {
+            gauge->~Gauge();
+        }
+    }
+}
@@ -0,0 +1,241 @@
+/**
+ * @file RegistryTests.cpp
+ * @brief Tests of the registry bookkeeping: probing, erasure, growth and storage reuse
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * The registries never dereference the real object, so these tests drive them with made-up addresses.
+ * The addresses are chosen for the compact registry's hash (see CompactRegistry::_home); the same
+ * sequences also run against the default registry.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+    class Cell
+    {
+    };
+
+    class CellMock
+    {
+    public:
+        virtual ~CellMock() = default;
+
+        MOCK_METHOD(int, value, ());
+    };
+
+    using CellMockVendor = MockVendor<CellMock, Cell>;
+
+    // The compact registry's smallest table, and its hash
+    constexpr size_t MIN_CAPACITY = 64;
+
+    size_t home(uintptr_t key, size_t capacity)
+    {
+        unsigned shift = 64;
+        for (size_t c = capacity; c > 1; c >>= 1)
+        {
+            --shift;
+        }
+        return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+
+    /**
+     * @return count made-up addresses, after start, whose home slot is the given one
+     */
+    std::vector<uintptr_t> addressesAt(size_t slot, size_t count, uintptr_t start = 0x1000)
+    {
+        std::vector<uintptr_t> found;
+        for (uintptr_t key = start; found.size() < count; key += 8)
+        {
+            if (home(key, MIN_CAPACITY) == slot)
+            {
+                found.push_back(key);
+            }
+        }
+        return found;
+    }
+
+    const Cell* cell(uintptr_t address)
+    {
+        return reinterpret_cast<const Cell*>(address);
+    }
+
+    std::shared_ptr<testing::NiceMock<CellMock>> queue(CellMockVendor& vendor)
+    {
+        auto mock = std::make_shared<testing::NiceMock<CellMock>>();
+        vendor.queueMock(mock);
+        return mock;
+    }
+
+    /**
+     * @return Whether mock() diagnosed the address as never vended
+     */
+    bool isUnknown(uintptr_t address)
+    {
+#if defined(MOCK_VENDOR_NO_LIFETIME_CHECKS)
+        return CellMockVendor::mock(cell(address)) == nullptr;
+#else
+        testing::TestPartResultArray failures;
+        testing::ScopedFakeTestPartResultReporter reporter(
+            testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, &failures);
+        try
+        {
+            CellMockVendor::mock(cell(address));
+        }
+        catch (const MockVendorException& e)
+        {
+            return std::string(e.what()).find("never vended") != std::string::npos;
+        }
+        return false;
+#endif
+    }
+}
+
+TEST(RegistryTest, EraseAcrossTheWrapPoint)
+{
+    CellMockVendor vendor;
+
+    // Slots 63, 0, 1 and 2 hold addresses whose home slots are 63, 0, 63 and 0: the third wrapped past
+    // the second, and the fourth was pushed past the third.
+    auto last = addressesAt(MIN_CAPACITY - 1, 2);
+    auto first = addressesAt(0, 2);
+    std::vector<uintptr_t> addresses{ last[0], first[0], last[1], first[1] };
+
+    std::vector<std::shared_ptr<testing::NiceMock<CellMock>>> mocks;
+    for (size_t i = 0; i < addresses.size(); ++i)
+    {
+        mocks.push_back(queue(vendor));
+    }
+    for (auto address : addresses)
+    {
+        CellMockVendor::vend(cell(address));
+    }
+
+    // Moving the object out of the last slot erases it. The third must shift back across the wrap, but
+    // not the second (its home is after the hole); the fourth then shifts into the third's slot.
+    uintptr_t moved = addressesAt(5, 1)[0];
+    CellMockVendor::move(cell(moved), cell(addresses[0]));
+
+    EXPECT_TRUE(isUnknown(addresses[0]));
+    EXPECT_EQ(mocks[0], CellMockVendor::mock(cell(moved)));
+    for (size_t i = 1; i < addresses.size(); ++i)
+    {
+        EXPECT_EQ(mocks[i], CellMockVendor::mock(cell(addresses[i]))) << "address " << i;
+    }
+
+    // And reinsertion finds the freed slot.
+    auto reinserted = queue(vendor);
+    CellMockVendor::vend(cell(addresses[0]));
+    EXPECT_EQ(reinserted, CellMockVendor::mock(cell(addresses[0])));
+    EXPECT_EQ(mocks[3], CellMockVendor::mock(cell(addresses[3])));
+
+    for (auto address : addresses)
+    {
+        CellMockVendor::destroy(cell(address));
+    }
+    CellMockVendor::destroy(cell(moved));
+}
+
+TEST(RegistryTest, MoveDestroyReinsertMatchesAModel)
+{
+    CellMockVendor vendor;
+
+    // Crowd a few home slots so that probe sequences are long and overlap, and grow the table well
+    // past its first size. Enough objects die to evict tombstones, which erases them too.
+    std::vector<uintptr_t> addresses;
+    for (size_t slot : { size_t(0), size_t(1), MIN_CAPACITY - 1, MIN_CAPACITY / 2 })
+    {
+        auto some = addressesAt(slot, 64);
+        addresses.insert(addresses.end(), some.begin(), some.end());
+    }
+    for (uintptr_t key = 0x100000; addresses.size() < 600; key += 8)
+    {
+        addresses.push_back(key);
+    }
+
+    std::map<uintptr_t, const CellMock*> live;
+    std::mt19937 random(1234);
+    for (int step = 0; step < 20000; ++step)
+    {
+        uintptr_t address = addresses[random() % addresses.size()];
+        auto it = live.find(address);
+        if (it == live.end())
+        {
+            // Alternate between queued and default mocks so that both kinds of storage are reused.
+            if (step % 3 == 0)
+            {
+                queue(vendor);
+            }
+            live[address] = CellMockVendor::vend(cell(address)).get();
+        }
+        else if (step % 2 == 0)
+        {
+            uintptr_t to = addresses[random() % addresses.size()];
+            if (live.count(to) == 0)
+            {
+                CellMockVendor::move(cell(to), cell(address));
+                live[to] = it->second;
+                live.erase(address);
+            }
+        }
+        else
+        {
+            CellMockVendor::destroy(cell(address));
+            live.erase(it);
+        }
+
+        if (step % 1000 == 0)
+        {
+            for (auto& [key, mock] : live)
+            {
+                ASSERT_EQ(mock, CellMockVendor::mock(cell(key)).get()) << "step " << step;
+            }
+        }
+    }
+
+    for (auto& [key, mock] : live)
+    {
+        ASSERT_EQ(mock, CellMockVendor::mock(cell(key)).get());
+        CellMockVendor::destroy(cell(key));
+    }
+}
+
+TEST(RegistryTest, DestroyedStorageIsReused)
+{
+    CellMockVendor vendor;
+    auto addresses = addressesAt(7, 3);
+
+    // A default mock's storage goes to the next default mock.
+    const CellMock* defaultMock = CellMockVendor::vend(cell(addresses[0])).get();
+    CellMockVendor::destroy(cell(addresses[0]));
+    EXPECT_EQ(defaultMock, CellMockVendor::vend(cell(addresses[1])).get());
+
+    // A queued mock is released when its object is destroyed, and the next one is vended in its place.
+    auto queued = queue(vendor);
+    CellMockVendor::vend(cell(addresses[2]));
+    std::weak_ptr<CellMock> released = queued;
+    queued.reset();
+    CellMockVendor::destroy(cell(addresses[2]));
+    EXPECT_TRUE(released.expired());
+
+    auto next = queue(vendor);
+    CellMockVendor::vend(cell(addresses[2]));
+    EXPECT_EQ(next, CellMockVendor::mock(cell(addresses[2])));
+
+    CellMockVendor::destroy(cell(addresses[1]));
+    CellMockVendor::destroy(cell(addresses[2]));
+}
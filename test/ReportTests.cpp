@@ -0,0 +1,286 @@
+/**
+ * @file ReportTests.cpp
+ * @brief Tests of the failures reported for unconsumed queued mocks and leaked mocks
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using testing::HasSubstr;
+using testing::Not;
+
+namespace
+{
+    class Part
+    {
+    public:
+        Part();
+        virtual ~Part();
+    };
+
+    class Gear : public Part
+    {
+    public:
+        Gear();
+        ~Gear() override;
+    };
+
+    class PartMock
+    {
+    public:
+        virtual ~PartMock() = default;
+
+        MOCK_METHOD(int, weight, ());
+    };
+
+    class GearMock : public PartMock
+    {
+    public:
+        MOCK_METHOD(int, teeth, ());
+    };
+
+    using PartMockVendor = MockVendor<PartMock, Part>;
+    using GearMockVendor = MockVendor<GearMock, Gear>;
+
+    GearMockVendor::BaseLink<PartMock, Part> gGearToPart;
+
+    Part::Part()
+    {
+        PartMockVendor::vend(this);
+    }
+
+    Part::~Part()
+    {
+        PartMockVendor::destroy(this);
+    }
+
+    Gear::Gear()
+    {
+        GearMockVendor::vend(this);
+    }
+
+    Gear::~Gear()
+    {
+        GearMockVendor::destroy(this);
+    }
+
+    // A distinct mock type for each tag, to leak more types than the report counts separately.
+    template <size_t Tag>
+    class TaggedPartMock : public PartMock
+    {
+    };
+
+    using Parts = std::vector<std::unique_ptr<Part>>;
+
+    template <typename T>
+    std::string typeName()
+    {
+        return typeid(T).name();
+    }
+
+    size_t countOf(const std::string& text, const std::string& pattern)
+    {
+        size_t count = 0;
+        for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    template <size_t... Tags>
+    void leakTagged(PartMockVendor& vendor, Parts& parts, std::index_sequence<Tags...>)
+    {
+        (vendor.queueMock(std::make_shared<testing::NiceMock<TaggedPartMock<Tags>>>()), ...);
+        for (size_t i = 0; i < sizeof...(Tags); ++i)
+        {
+            parts.push_back(std::make_unique<Part>());
+        }
+    }
+
+    void queue(PartMockVendor& vendor, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            vendor.queueMock(std::make_shared<testing::NiceMock<PartMock>>());
+        }
+    }
+
+    /**
+     * @brief Run the scenario with a new vendor, then destroy the vendor.
+     * @return The single failure reported by the vendor
+     */
+    std::string reportOf(const std::function<void(PartMockVendor&)>& scenario)
+    {
+        testing::TestPartResultArray failures;
+        {
+            testing::ScopedFakeTestPartResultReporter reporter(
+                testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, &failures);
+            PartMockVendor vendor;
+            scenario(vendor);
+        }
+
+        EXPECT_EQ(1, failures.size());
+        return (failures.size() > 0) ? failures.GetTestPartResult(0).message() : "";
+    }
+}
+
+TEST(ReportTest, UnconsumedMocksAndVendHistory)
+{
+    std::string report = reportOf([] (PartMockVendor& vendor)
+    {
+        queue(vendor, 3);
+        Part part;
+    });
+
+    EXPECT_THAT(report, HasSubstr("Failure to consume all queued mocks"));
+    EXPECT_THAT(report, HasSubstr(" - 2 of 3 remaining"));
+    EXPECT_THAT(report, HasSubstr("Unconsumed: #1 "));
+    EXPECT_THAT(report, HasSubstr("Unconsumed: #2 "));
+    EXPECT_THAT(report, HasSubstr("Last 1 of 1 vends"));
+    EXPECT_THAT(report, HasSubstr("Vend #0: queued #0, 2 left in queue"));
+}
+
+TEST(ReportTest, RestoreAmendsTheVendItUndoes)
+{
+    std::string report = reportOf([] (PartMockVendor& vendor)
+    {
+        queue(vendor, 2);
+        Gear gear;
+        Part part;
+    });
+
+    EXPECT_THAT(report, HasSubstr("Vend #0: queued #0 (returned to queue for derived class), 2 left in queue"));
+    EXPECT_THAT(report, HasSubstr("Vend #1: queued #0, 1 left in queue"));
+    EXPECT_THAT(report, HasSubstr("Unconsumed: #1 "));
+}
+
+TEST(ReportTest, ConsumedMockIsNotReportedAsRestored)
+{
+    // The part consumes the only queued mock, so the gear's base class part gets a default one.
+    std::string report = reportOf([] (PartMockVendor& vendor)
+    {
+        queue(vendor, 1);
+        {
+            Part part;
+        }
+        Gear gear;
+        queue(vendor, 1);
+    });
+
+    EXPECT_THAT(report, HasSubstr("Vend #0: queued #0, 0 left in queue"));
+    EXPECT_THAT(report, HasSubstr("Vend #1: default, 0 left in queue"));
+    EXPECT_THAT(report, HasSubstr("Unconsumed: #1 "));
+    EXPECT_THAT(report, Not(HasSubstr("returned to queue")));
+}
+
+// The leaked objects outlive the vendor in each of these tests, and are deleted after it has reported them.
+
+TEST(ReportTest, LeakedMocksAreCountedPerType)
+{
+    Parts parts;
+    EXPECT_NONFATAL_FAILURE(
+    {
+        PartMockVendor vendor;
+        for (int i = 0; i < 3; ++i)
+        {
+            parts.push_back(std::make_unique<Part>());
+        }
+    }, "Not all mock instances were destroyed - 3 remaining\n   3 x " + typeName<testing::NiceMock<PartMock>>());
+
+    Parts mixed;
+    std::string report = reportOf([&] (PartMockVendor& vendor)
+    {
+        vendor.queueMock(std::make_shared<testing::StrictMock<PartMock>>());
+        vendor.queueMock(std::make_shared<testing::StrictMock<PartMock>>());
+        for (int i = 0; i < 5; ++i)
+        {
+            mixed.push_back(std::make_unique<Part>());
+        }
+    });
+
+    EXPECT_THAT(report, HasSubstr(" - 5 remaining"));
+    EXPECT_THAT(report, HasSubstr("   2 x " + typeName<testing::StrictMock<PartMock>>() + "\n"));
+    EXPECT_THAT(report, HasSubstr("   3 x " + typeName<testing::NiceMock<PartMock>>() + "\n"));
+    EXPECT_THAT(report, Not(HasSubstr("(other types)")));
+}
+
+TEST(ReportTest, LeakedTypesBeyondTheLimitAreCountedTogether)
+{
+    Parts parts;
+    std::string report = reportOf([&] (PartMockVendor& vendor)
+    {
+        leakTagged(vendor, parts, std::make_index_sequence<10>());
+    });
+
+    EXPECT_THAT(report, HasSubstr(" - 10 remaining"));
+    EXPECT_EQ(8, countOf(report, " x ") - countOf(report, " x (other types)"));
+    EXPECT_THAT(report, HasSubstr("   2 x (other types)"));
+}
+
+TEST(ReportTest, LeakedMockSampleIsBounded)
+{
+    Parts parts;
+    EXPECT_NONFATAL_FAILURE(
+    {
+        PartMockVendor vendor;
+        for (int i = 0; i < 100; ++i)
+        {
+            parts.push_back(std::make_unique<Part>());
+        }
+    }, "    More...");
+
+    std::string report = reportOf([&] (PartMockVendor& /*vendor*/)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            parts.push_back(std::make_unique<Part>());
+        }
+    });
+    size_t sampled = countOf(report, "   Real: ");
+    EXPECT_GT(sampled, 0);
+    EXPECT_LT(sampled, 100);
+}
+
+TEST(ReportTest, ManyLeakedMocksAreReclaimedInTheBackground)
+{
+    // At the vendor's threshold for handing leaked mocks to the reclaimer
+    constexpr size_t LEAKED = 100000;
+
+    Parts parts;
+    std::weak_ptr<PartMock> queued;
+    std::string report = reportOf([&] (PartMockVendor& vendor)
+    {
+        auto mock = std::make_shared<testing::NiceMock<PartMock>>();
+        queued = mock;
+        vendor.queueMock(std::move(mock));
+        for (size_t i = 0; i < LEAKED; ++i)
+        {
+            parts.push_back(std::make_unique<Part>());
+        }
+    });
+
+    EXPECT_THAT(report, HasSubstr(" - 100000 remaining"));
+    MockVendorReclaimer::drain();
+    EXPECT_TRUE(queued.expired());
+
+    // The objects are no longer known to the (new) registry.
+    parts.clear();
+    PartMockVendor vendor;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file ScenarioTests.cpp
+ * @brief Tests of staging queued mocks on a MockVendorScenario
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendorScenario.h>
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+using testing::HasSubstr;
+
+namespace
+{
+    class Door
+    {
+    public:
+        Door();
+        ~Door();
+    };
+
+    class Lock
+    {
+    public:
+        Lock();
+        ~Lock();
+    };
+
+    class DoorMock
+    {
+    public:
+        virtual ~DoorMock() = default;
+
+        MOCK_METHOD(bool, open, ());
+    };
+
+    class LockMock
+    {
+    public:
+        virtual ~LockMock() = default;
+
+        MOCK_METHOD(bool, locked, ());
+    };
+
+    using DoorMockVendor = MockVendor<DoorMock, Door>;
+    using LockMockVendor = MockVendor<LockMock, Lock>;
+
+    Door::Door()
+    {
+        DoorMockVendor::vend(this);
+    }
+
+    Door::~Door()
+    {
+        DoorMockVendor::destroy(this);
+    }
+
+    Lock::Lock()
+    {
+        LockMockVendor::vend(this);
+    }
+
+    Lock::~Lock()
+    {
+        LockMockVendor::destroy(this);
+    }
+
+    template <typename Mock>
+    std::shared_ptr<Mock> makeMock()
+    {
+        return std::make_shared<testing::NiceMock<Mock>>();
+    }
+}
+
+TEST(ScenarioTest, CommitQueuesEachTypeInStagingOrder)
+{
+    DoorMockVendor doorVendor;
+    LockMockVendor lockVendor;
+    auto door1 = makeMock<DoorMock>();
+    auto door2 = makeMock<DoorMock>();
+    auto lock1 = makeMock<LockMock>();
+
+    MockVendorScenario scenario;
+    scenario.queueMock(doorVendor, door1)
+            .queueMock(lockVendor, lock1)
+            .queueMock(doorVendor, door2);
+
+    // Nothing is queued until the commit.
+    {
+        Door door;
+        EXPECT_NE(door1, DoorMockVendor::mock(&door));
+    }
+
+    scenario.commit();
+
+    Lock lock;
+    Door first;
+    Door second;
+    EXPECT_EQ(lock1, LockMockVendor::mock(&lock));
+    EXPECT_EQ(door1, DoorMockVendor::mock(&first));
+    EXPECT_EQ(door2, DoorMockVendor::mock(&second));
+}
+
+TEST(ScenarioTest, CommittedMocksFollowTheVendorsQueueIndices)
+{
+    // The queue indices continue from mocks queued directly, as the unconsumed report shows.
+    testing::TestPartResultArray failures;
+    {
+        testing::ScopedFakeTestPartResultReporter reporter(
+            testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, &failures);
+        DoorMockVendor doorVendor;
+        doorVendor.queueMock(makeMock<DoorMock>());
+
+        MockVendorScenario scenario;
+        scenario.queueMock(doorVendor, makeMock<DoorMock>())
+                .queueMock(doorVendor, makeMock<DoorMock>());
+        scenario.commit();
+
+        Door door;
+        Door other;
+    }
+
+    ASSERT_EQ(1, failures.size());
+    std::string report = failures.GetTestPartResult(0).message();
+    EXPECT_THAT(report, HasSubstr(" - 1 of 3 remaining"));
+    EXPECT_THAT(report, HasSubstr("Unconsumed: #2 "));
+    EXPECT_THAT(report, HasSubstr("Vend #1: queued #1, 1 left in queue"));
+}
+
+TEST(ScenarioTest, ScenarioIsReusableAfterCommit)
+{
+    DoorMockVendor doorVendor;
+    auto first = makeMock<DoorMock>();
+    auto second = makeMock<DoorMock>();
+
+    MockVendorScenario scenario;
+    scenario.queueMock(doorVendor, first).commit();
+    scenario.queueMock(doorVendor, second).commit();
+
+    Door door1;
+    Door door2;
+    EXPECT_EQ(first, DoorMockVendor::mock(&door1));
+    EXPECT_EQ(second, DoorMockVendor::mock(&door2));
+
+    // Committing an empty scenario queues nothing.
+    scenario.commit();
+    Door door3;
+    EXPECT_NE(second, DoorMockVendor::mock(&door3));
+}
+
+TEST(ScenarioTest, UncommittedMocksAreDiscarded)
+{
+    DoorMockVendor doorVendor;
+    std::weak_ptr<DoorMock> staged;
+    {
+        auto mock = makeMock<DoorMock>();
+        staged = mock;
+
+        MockVendorScenario scenario;
+        scenario.queueMock(doorVendor, mock);
+    }
+    EXPECT_TRUE(staged.expired());
+
+    Door door;
+    EXPECT_NE(nullptr, DoorMockVendor::mock(&door));
+}
+
+TEST(ScenarioTest, NonOwningMockIsRejectedWhenStaged)
+{
+    DoorMockVendor doorVendor;
+    Door door;
+    auto mock = DoorMockVendor::mock(&door);
+
+    MockVendorScenario scenario;
+    if (mock.use_count() == 0)
+    {
+        // A default mock of the compact registry
+        EXPECT_THROW(scenario.queueMock(doorVendor, mock), MockVendorException);
+    }
+    else
+    {
+        scenario.queueMock(doorVendor, mock).commit();
+        Door next;
+        EXPECT_EQ(mock, DoorMockVendor::mock(&next));
+    }
+}
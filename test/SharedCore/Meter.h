@@ -0,0 +1,41 @@
+/**
+ * @file Meter.h
+ * @brief A mocked class whose methods are split across two shared libraries (MOCK_VENDOR_SHARED_CORE)
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * The libraries and the test program are all built with hidden visibility and without STB_GNU_UNIQUE, so
+ * each has its own instantiation of MockVendor<MeterMock, Meter>. Only the core makes them share a
+ * registry. The mock is deliberately not declared with MOCK_VENDOR_API.
+ */
+
+#pragma once
+
+#include <MockVendor/MockVendor.h>
+
+#define METER_API __attribute__((visibility("default")))
+
+class METER_API Meter
+{
+public:
+    Meter();            // Defined in the construction library
+    virtual ~Meter();
+
+    int read();         // Defined in the methods library
+};
+
+class MeterMock
+{
+public:
+    virtual ~MeterMock() = default;
+
+    MOCK_METHOD(int, read, ());
+};
+
+using MeterMockVendor = MockVendor<MeterMock, Meter>;
@@ -0,0 +1,19 @@
+/**
+ * @file MeterMethods.cpp
+ * @brief The methods of Meter, in a shared library of their own
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "Meter.h"
+
+int Meter::read()
+{
+    return MeterMockVendor::mock(this)->read();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file SharedCoreTests.cpp
+ * @brief Tests of one registry per process when a mocked class spans several shared libraries
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "SharedCore/Meter.h"
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+#include <new>
+#include <string>
+
+using testing::Return;
+
+TEST(SharedCoreTest, QueuedMockReachesEveryLibrary)
+{
+    // Queued here, vended in the construction library and called in the methods library.
+    MeterMockVendor vendor;
+    auto queued = std::make_shared<testing::NiceMock<MeterMock>>();
+    ON_CALL(*queued, read()).WillByDefault(Return(5));
+    vendor.queueMock(queued);
+
+    Meter meter;
+    EXPECT_EQ(queued, MeterMockVendor::mock(&meter));
+    EXPECT_EQ(5, meter.read());
+}
+
+TEST(SharedCoreTest, DefaultMockReachesEveryLibrary)
+{
+    MeterMockVendor vendor;
+    Meter meter;
+    ON_CALL(*MeterMockVendor::mock(&meter), read()).WillByDefault(Return(9));
+
+    EXPECT_EQ(9, meter.read());
+}
+
+TEST(SharedCoreTest, DestroyInOneLibraryIsDiagnosedInAnother)
+{
+    MeterMockVendor vendor;
+    alignas(Meter) unsigned char storage[sizeof(Meter)];
+    (new (storage) Meter())->~Meter();
+
+    std::string diagnosis;
+    {
+        testing::TestPartResultArray failures;
+        testing::ScopedFakeTestPartResultReporter reporter(
+            testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, &failures);
+        try
+        {
+            std::launder(reinterpret_cast<Meter*>(storage))->read();
+        }
+        catch (const MockVendorException& e)
+        {
+            diagnosis = e.what();
+        }
+    }
+    EXPECT_THAT(diagnosis, testing::HasSubstr("after it was destroyed"));
+}
+
+TEST(SharedCoreTest, ProfilerTotalsIncludeEveryLibrary)
+{
+    MockVendorProfiler::reset();
+    MockVendorProfiler::enable(true);
+    {
+        Meter meter;
+        meter.read();
+    }
+    MockVendorProfiler::enable(false);
+
+    EXPECT_GT(MockVendorProfiler::operationTime().count(), 0);
+}
@@ -0,0 +1,227 @@
+/**
+ * @file TraceTests.cpp
+ * @brief Tests of the trace file written by MockVendorTrace
+ *
+ * @author Deon McClung
+ *
+ * @copyright 2023 Deon McClung
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include <MockVendor/MockVendor.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    class Valve
+    {
+    public:
+        Valve();
+        ~Valve();
+
+        void open();
+    };
+
+    class Pump
+    {
+    public:
+        Pump();
+        ~Pump();
+    };
+
+    class ValveMock
+    {
+    public:
+        virtual ~ValveMock() = default;
+
+        MOCK_METHOD(void, open, ());
+    };
+
+    class PumpMock
+    {
+    public:
+        virtual ~PumpMock() = default;
+
+        MOCK_METHOD(void, start, ());
+    };
+
+    using ValveMockVendor = MockVendor<ValveMock, Valve>;
+    using PumpMockVendor = MockVendor<PumpMock, Pump>;
+
+    Valve::Valve()
+    {
+        ValveMockVendor::vend(this);
+    }
+
+    Valve::~Valve()
+    {
+        ValveMockVendor::destroy(this);
+    }
+
+    void Valve::open()
+    {
+        ValveMockVendor::mock(this)->open();
+    }
+
+    Pump::Pump()
+    {
+        PumpMockVendor::vend(this);
+    }
+
+    Pump::~Pump()
+    {
+        PumpMockVendor::destroy(this);
+    }
+
+    using Op = MockVendorTrace::Op;
+
+    struct ReadRecord
+    {
+        MockVendorTrace::Record record;
+        std::string             name;       // The type name following a TypeName record
+    };
+
+    struct ReadTrace
+    {
+        MockVendorTrace::Header header;
+        std::vector<ReadRecord> records;
+    };
+
+    ReadTrace readTrace(const std::string& path)
+    {
+        ReadTrace trace{};
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(&trace.header), sizeof(trace.header));
+
+        ReadRecord rec{};
+        while (in.read(reinterpret_cast<char*>(&rec.record), sizeof(rec.record)))
+        {
+            rec.name.clear();
+            if (static_cast<Op>(rec.record.op) == Op::TypeName)
+            {
+                rec.name.resize(rec.record.aux);
+                in.read(&rec.name[0], static_cast<std::streamsize>(rec.name.size()));
+            }
+            trace.records.push_back(rec);
+        }
+        return trace;
+    }
+
+    /**
+     * @brief Record a valve and a pump being used, in a trace of their own.
+     */
+    ReadTrace recordScenario(const std::string& path)
+    {
+        EXPECT_TRUE(MockVendorTrace::start(path));
+        EXPECT_TRUE(MockVendorTrace::isRecording());
+        {
+            Valve valve;
+            valve.open();
+            Pump pump;
+        }
+        MockVendorTrace::stop();
+        EXPECT_FALSE(MockVendorTrace::isRecording());
+
+        return readTrace(path);
+    }
+
+    // The tests replace the trace in progress, so they do not run while a suite is being recorded.
+    class TraceTest : public testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            if (MockVendorTrace::isRecording())
+            {
+                GTEST_SKIP() << "A trace is being recorded";
+            }
+        }
+    };
+
+    void expectRecord(const ReadRecord& rec, Op op, uint16_t type, const void* ptr = nullptr)
+    {
+        EXPECT_EQ(static_cast<uint8_t>(op), rec.record.op);
+        EXPECT_EQ(type, rec.record.type);
+        if (ptr != nullptr)
+        {
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr), rec.record.ptr);
+        }
+    }
+}
+
+TEST_F(TraceTest, RecordsAreReadBack)
+{
+    const std::string path = testing::TempDir() + "mockvendor_trace_test.bin";
+    ReadTrace trace = recordScenario(path);
+    std::remove(path.c_str());
+
+    EXPECT_TRUE(std::equal(std::begin(MockVendorTrace::MAGIC), std::end(MockVendorTrace::MAGIC), trace.header.magic));
+    EXPECT_EQ(MockVendorTrace::VERSION, trace.header.version);
+    EXPECT_EQ(sizeof(MockVendorTrace::Record), trace.header.recordSize);
+
+    // Each type is named the first time it appears, then referred to by its number.
+    ASSERT_EQ(7u, trace.records.size());
+    expectRecord(trace.records[0], Op::TypeName, 0);
+    EXPECT_EQ(typeid(ValveMock).name(), trace.records[0].name);
+    expectRecord(trace.records[1], Op::Vend, 0);
+    expectRecord(trace.records[2], Op::Mock, 0, reinterpret_cast<const void*>(trace.records[1].record.ptr));
+    expectRecord(trace.records[3], Op::TypeName, 1);
+    EXPECT_EQ(typeid(PumpMock).name(), trace.records[3].name);
+    expectRecord(trace.records[4], Op::Vend, 1);
+    expectRecord(trace.records[5], Op::Destroy, 1, reinterpret_cast<const void*>(trace.records[4].record.ptr));
+    expectRecord(trace.records[6], Op::Destroy, 0, reinterpret_cast<const void*>(trace.records[1].record.ptr));
+
+    EXPECT_EQ(0u, trace.records[1].record.aux);
+    EXPECT_LE(trace.records[1].record.timestamp, trace.records[6].record.timestamp);
+}
+
+TEST_F(TraceTest, TypesAreRenamedInEveryTrace)
+{
+    const std::string path = testing::TempDir() + "mockvendor_trace_test.bin";
+
+    // The pump alone first, so that it is type 0 here but type 1 in the second trace.
+    ASSERT_TRUE(MockVendorTrace::start(path));
+    {
+        Pump pump;
+    }
+    MockVendorTrace::stop();
+    ReadTrace first = readTrace(path);
+
+    ReadTrace second = recordScenario(path);
+    std::remove(path.c_str());
+
+    ASSERT_EQ(3u, first.records.size());
+    expectRecord(first.records[0], Op::TypeName, 0);
+    EXPECT_EQ(typeid(PumpMock).name(), first.records[0].name);
+
+    ASSERT_EQ(7u, second.records.size());
+    expectRecord(second.records[0], Op::TypeName, 0);
+    EXPECT_EQ(typeid(ValveMock).name(), second.records[0].name);
+    expectRecord(second.records[3], Op::TypeName, 1);
+    EXPECT_EQ(typeid(PumpMock).name(), second.records[3].name);
+}
+
+TEST_F(TraceTest, NothingIsRecordedWhenStopped)
+{
+    const std::string path = testing::TempDir() + "mockvendor_trace_test.bin";
+    ASSERT_TRUE(MockVendorTrace::start(path));
+    MockVendorTrace::stop();
+    {
+        Valve valve;
+    }
+
+    ReadTrace trace = readTrace(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(MockVendorTrace::VERSION, trace.header.version);
+    EXPECT_TRUE(trace.records.empty());
+}